@@ -5,76 +5,96 @@
 
 #include <phosphor-logging/elog-errors.hpp>
 
-#include <unordered_map>
-
-using buttonIfCreatorMethod = std::function<std::unique_ptr<ButtonIface>(
-    sdbusplus::bus_t& bus, EventPtr& event, buttonConfig& buttonCfg)>;
+#include <charconv>
+#include <memory>
+#include <string>
 
 /**
  * @brief This is abstract factory for the creating phosphor buttons objects
- * based on the button  / formfactor type given.
+ * based on the button  / formfactor type given. The button types are
+ * resolved at compile time from the types built in, see
+ * src/button_factory.cpp.
  */
 
 class ButtonFactory
 {
   public:
-    static ButtonFactory& instance()
+    /**
+     * @brief returns the D-Bus object path of a button instance.
+     * A gpio config can name its object path with "dbus_object_path", or
+     * give an "instance" index which replaces the instance number at the
+     * end of the default path of the button type, e.g. instance 2 of the
+     * power button is /xyz/openbmc_project/Chassis/Buttons/Power2.
+     */
+    static std::string getInstancePath(const char* defaultPath,
+                                       const buttonConfig& buttonCfg)
     {
-        static ButtonFactory buttonFactoryObj;
-        return buttonFactoryObj;
+        const auto& json = buttonCfg.extraJsonInfo;
+        if (json.contains("dbus_object_path"))
+        {
+            return json["dbus_object_path"].get<std::string>();
+        }
+
+        std::string path{defaultPath};
+        if (json.contains("instance"))
+        {
+            auto base = path.find_last_not_of("0123456789");
+            path.erase(base + 1);
+            path += std::to_string(json["instance"].get<size_t>());
+        }
+        return path;
     }
 
     /**
-     * @brief this method creates a key and value pair element
-     * for the given button interface where key is the form factor
-     * name and the value is lambda method to return
-     * the instance of the button interface.
-     * This key value pair is stored in the Map buttonIfaceRegistry.
+     * @brief returns the instance index of a button, the number at the end
+     * of its object path (2 for Power2), which the button handler takes as
+     * the host number. A button which is not on D-Bus, or whose path ends
+     * in a number out of range, takes its "instance" index, 0 by default.
      */
-
-    template <typename T>
-    void addToRegistry()
+    static size_t getInstanceIndex(const buttonConfig& buttonCfg)
     {
-        buttonIfaceRegistry[std::string(T::getFormFactorName())] =
-            [](sdbusplus::bus_t& bus, EventPtr& event,
-               buttonConfig& buttonCfg) {
-            return std::make_unique<T>(bus, T::getDbusObjectPath(), event,
-                                       buttonCfg);
-        };
+        const auto& path = buttonCfg.dbusObjectPath;
+        auto digits = path.find_last_not_of("0123456789") + 1;
+        size_t index = 0;
+        if (!path.empty() && (digits < path.size()) &&
+            (std::from_chars(path.data() + digits, path.data() + path.size(),
+                             index)
+                 .ec == std::errc{}))
+        {
+            return index;
+        }
+        return buttonCfg.extraJsonInfo.value("instance", size_t(0));
     }
+
+    /**
+     * @brief returns the button interface object corresponding to the
+     * button form factor name provided, nullptr if the button type is
+     * unknown or not built in.
+     */
+    static std::unique_ptr<ButtonIface> createInstance(const std::string& name,
+                                                       sdbusplus::bus_t& bus,
+                                                       EventPtr& event,
+                                                       buttonConfig& buttonCfg);
+
     /**
-     * @brief this method returns the button interface object
-     *    corresponding to the button formfactor name provided
+     * @brief creates a button interface object of the given type
      */
-    std::unique_ptr<ButtonIface> createInstance(const std::string& name,
-                                                sdbusplus::bus_t& bus,
-                                                EventPtr& event,
-                                                buttonConfig& buttonCfg)
+    template <typename T>
+    static std::unique_ptr<ButtonIface> create(sdbusplus::bus_t& bus,
+                                               EventPtr& event,
+                                               buttonConfig& buttonCfg)
     {
-        // find matching name in the registry and call factory method.
-        auto objectIter = buttonIfaceRegistry.find(name);
-        if (objectIter != buttonIfaceRegistry.end())
+        if (!buttonCfg.eventPriority)
         {
-            return objectIter->second(bus, event, buttonCfg);
+            buttonCfg.eventPriority = T::getDefaultEventPriority();
         }
-        else
+        if (T::getDbusObjectPath() != nullptr)
         {
-            return nullptr;
+            buttonCfg.dbusObjectPath =
+                getInstancePath(T::getDbusObjectPath(), buttonCfg);
         }
-    }
-
-  private:
-    // This map is the registry for keeping supported button interface types.
-    std::unordered_map<std::string, buttonIfCreatorMethod> buttonIfaceRegistry;
-};
-
-template <class T>
-class ButtonIFRegister
-{
-  public:
-    ButtonIFRegister()
-    {
-        // register the class factory function
-        ButtonFactory::instance().addToRegistry<T>();
+        buttonCfg.instance = getInstanceIndex(buttonCfg);
+        return std::make_unique<T>(bus, buttonCfg.dbusObjectPath.c_str(),
+                                   event, buttonCfg);
     }
 };
@@ -1,6 +1,17 @@
 #pragma once
+#include "button_policy.hpp"
+#include "common.hpp"
+#include "latency_histogram.hpp"
+
 #include <sdbusplus/bus.hpp>
 #include <sdbusplus/bus/match.hpp>
+#include <xyz/openbmc_project/State/Host/server.hpp>
+
+#include <deque>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
 
 namespace phosphor
 {
@@ -11,7 +22,8 @@ enum class PowerEvent
     powerPressed,
     resetPressed,
     powerReleased,
-    resetReleased
+    resetReleased,
+    powerLongPressed
 };
 /**
  * @class Handler
@@ -41,7 +53,48 @@ class Handler
      */
     explicit Handler(sdbusplus::bus_t& bus);
 
+    /**
+     * @brief Constructor with the button policy read from another file
+     * than the default one, such as the policy of a test
+     *
+     * @param[in] bus - sdbusplus connection object
+     * @param[in] policyPath - button policy json file
+     */
+    Handler(sdbusplus::bus_t& bus, const std::string& policyPath);
+
   private:
+    /**
+     * @brief State kept per button instance (D-Bus object path)
+     */
+    struct ButtonInstance
+    {
+        // host the button acts on, 0 follows the host selector position
+        size_t host;
+        // the long press action already ran for the current press, so its
+        // release must not run it again
+        bool longPressHandled = false;
+    };
+
+    /**
+     * @brief Looks up all the button objects implementing the interface
+     * and adds them to the button instances.
+     *
+     * @param[in] interface - button D-Bus interface
+     *
+     * @return true if at least one button was found
+     */
+    bool addButtonInstances(const std::string& interface);
+
+    /**
+     * @brief Returns the state of the button instance at the object path,
+     * adding it if it is not known yet.
+     *
+     * @param[in] path - button D-Bus object path
+     *
+     * @return nullptr if the instance number of the path is out of range
+     */
+    ButtonInstance* getButtonInstance(const std::string& path);
+
     /**
      * @brief The handler for a power button press
      *
@@ -51,6 +104,17 @@ class Handler
      */
     void powerReleased(sdbusplus::message_t& msg);
 
+    /**
+     * @brief The handler for a power button long press
+     *
+     * Sent by the buttons daemon as soon as the button has been held for
+     * the long press time, so the long press action does not wait for the
+     * release.
+     *
+     * @param[in] msg - sdbusplus message from signal
+     */
+    void powerLongPressed(sdbusplus::message_t& msg);
+
     /**
      * @brief The handler for an ID button press
      *
@@ -81,11 +145,78 @@ class Handler
     void debugHostSelectorReleased(sdbusplus::message_t& msg);
 
     /**
-     * @brief Checks if system is powered on
+     * @brief The handler for a OCP debug card host selector button long
+     * press
+     *
+     * A long press does not move the host selector position.
+     *
+     * @param[in] msg - sdbusplus message from signal
+     */
+    void debugHostSelectorLongPressed(sdbusplus::message_t& msg);
+
+    /**
+     * @brief Checks if system is powered on, the host state is only read
+     * from D-Bus the first time and then follows its PropertiesChanged
+     * signals
      *
      * @return true if powered on, false else
      */
-    bool poweredOn(size_t hostNumber) const;
+    bool poweredOn(size_t hostNumber);
+
+    /**
+     * @brief Power state of a host, as far as the handler knows it
+     */
+    struct HostTransition
+    {
+        using HostState =
+            sdbusplus::xyz::openbmc_project::State::server::Host::HostState;
+
+        // CurrentHostState, unknown until read or signaled
+        std::optional<HostState> current;
+        // state a requested transition leads to, until it is reached or
+        // the transition window expires
+        std::optional<HostState> target;
+        uint64_t requestUsec = 0;
+        // button events dropped while the host was transitioning
+        size_t dropped = 0;
+        // D-Bus name the state was read from or signaled by, the state is
+        // forgotten when it loses its owner
+        std::string service;
+    };
+
+    HostTransition& getHostTransition(size_t hostNumber);
+
+    /**
+     * @brief Updates the cached host state from a PropertiesChanged signal
+     * of a host state object
+     *
+     * @param[in] msg - sdbusplus message from signal
+     */
+    void hostPropertiesChanged(sdbusplus::message_t& msg);
+
+    /**
+     * @brief Checks whether a host transition can be requested, a button
+     * event arriving while the host is still transitioning is dropped
+     * without any D-Bus call
+     *
+     * @param[in] action - the action about to run
+     * @param[in] hostNumber - host the action applies to
+     *
+     * @return true if the transition is requested, the host is then
+     *         transitioning until it reaches the target state
+     */
+    bool acceptHostTransition(PolicyAction action, size_t hostNumber);
+
+    uint64_t getMonotonicUsec();
+
+    /**
+     * @brief Makes a synchronous D-Bus call, counted in dbusCalls
+     *
+     * @param[in] method - the method call message
+     *
+     * @return the reply message
+     */
+    sdbusplus::message_t call(sdbusplus::message_t& method) const;
 
     /*
      * @return std::string - the D-Bus service name if found, else
@@ -103,6 +234,36 @@ class Handler
      */
 
     size_t getHostSelectorValue();
+
+    /**
+     * @brief returns the host selector service, looking it up until it
+     * is found
+     */
+    const std::string& getHostSelectorService();
+
+    /**
+     * @brief reads the host selector position and max position from
+     * D-Bus unless they are cached already
+     */
+    void readHostSelector();
+
+    /**
+     * @brief Updates the cached host selector position from its
+     * PropertiesChanged signal
+     *
+     * @param[in] msg - sdbusplus message from signal
+     */
+    void hostSelectorPropertiesChanged(sdbusplus::message_t& msg);
+
+    /**
+     * @brief Drops the cached host selector properties and host states
+     * whose service went away, they are read again on the next button
+     * event once the service is back
+     *
+     * @param[in] msg - sdbusplus message from the NameOwnerChanged signal
+     */
+    void nameOwnerChanged(sdbusplus::message_t& msg);
+
     /**
      * @brief increases the host selector position property
      * by 1 upto max host selector position
@@ -123,16 +284,102 @@ class Handler
      * @brief trigger the power ctrl event based on the
      *  button press event type.
      *
+     * @param[in] instanceHost - host of the button instance, 0 for the
+     *                           button following the host selector
+     *
      * @return void
      */
     void handlePowerEvent(PowerEvent powerEventType,
-                          std::chrono::microseconds duration);
+                          std::chrono::microseconds duration,
+                          size_t instanceHost = 0);
+
+    /**
+     * @brief requests the power transition of a policy action
+     *
+     * @param[in] action - the action picked by the policy
+     * @param[in] hostNumber - host the action applies to
+     */
+    void runPolicyAction(PolicyAction action, size_t hostNumber);
+
+    /**
+     * @brief builds the property Set call requesting the power transition
+     * of a single host action
+     *
+     * @param[in] action - a host or chassis action
+     * @param[in] hostNumber - host the action applies to
+     */
+    sdbusplus::message_t newTransitionCall(PolicyAction action,
+                                           size_t hostNumber);
+
+    /**
+     * @brief returns the highest host selector position, which is the
+     * number of hosts of a multi-host system
+     */
+    size_t getMaxHostPosition();
+
+    /**
+     * @brief starts an "all hosts" action, the host transitions are sent
+     * asynchronously within the fan out limits of the policy
+     *
+     * @param[in] action - one of the allHosts actions
+     */
+    void startAllHosts(PolicyAction action);
+
+    /**
+     * @brief sends the next host transitions of the running "all hosts"
+     * action as far as the concurrency limit and stagger delay allow
+     */
+    void runAllHosts();
+
+    /**
+     * @brief handles the reply to the transition of one host
+     */
+    void allHostsReply(size_t host, sdbusplus::message_t& reply);
+
+    static int allHostsTimerHandler(sd_event_source* es, uint64_t usec,
+                                    void* userdata);
+
+    /**
+     * @brief State of a running "all hosts" action
+     */
+    struct AllHostsRequest
+    {
+        PolicyAction action;
+        // transition sent to each host
+        PolicyAction hostAction;
+        std::deque<size_t> pending;
+        // pending D-Bus calls by host
+        std::map<size_t, sdbusplus::slot_t> inFlight;
+        size_t total = 0;
+        size_t failed = 0;
+        // hosts left out as they were already transitioning
+        size_t skipped = 0;
+        // earliest start of the next host transition
+        uint64_t nextStartUsec = 0;
+    };
 
     /**
      * @brief sdbusplus connection object
      */
     sdbusplus::bus_t& bus;
 
+    /**
+     * @brief Power action for each button event
+     */
+    ButtonPolicy policy;
+
+    /**
+     * @brief Time from the wake-up on a button signal to the completion of
+     * its transition request
+     */
+    LatencyHistogram actionLatency;
+
+    /**
+     * @brief Number of D-Bus method calls made, the difference over the
+     * handling of a press is logged to check the caching of the handler
+     */
+    mutable uint64_t dbusCalls = 0;
+
     /**
      * @brief Matches on the power button released signal
      */
@@ -157,6 +404,65 @@ class Handler
      * @brief Matches on the ocp debug host selector  button released signal
      */
     std::unique_ptr<sdbusplus::bus::match_t> debugHSButtonReleased;
+
+    /**
+     * @brief Matches on the ocp debug host selector button long press signal
+     */
+    std::unique_ptr<sdbusplus::bus::match_t> debugHSButtonLongPressed;
+
+    /**
+     * @brief Matches on the PropertiesChanged signal of the host states
+     */
+    std::unique_ptr<sdbusplus::bus::match_t> hostStateChanged;
+
+    /**
+     * @brief Matches on the PropertiesChanged signal of the host selector
+     */
+    std::unique_ptr<sdbusplus::bus::match_t> hostSelectorChanged;
+
+    /**
+     * @brief Matches on the NameOwnerChanged signal of the services whose
+     * properties are cached
+     */
+    std::unique_ptr<sdbusplus::bus::match_t> serviceOwnerChanged;
+
+    /**
+     * @brief Host selector properties, cached so that a button event
+     * does not need a mapper lookup and a property read
+     */
+    struct
+    {
+        std::string service;
+        std::optional<size_t> position;
+        std::optional<size_t> maxPosition;
+        // positions set by the handler whose signal is not received yet
+        std::deque<size_t> pendingSets;
+    } hostSelector;
+
+    /**
+     * @brief Power state of each host
+     */
+    std::unordered_map<size_t, HostTransition> hostTransitions;
+
+    /**
+     * @brief Button instances by D-Bus object path
+     */
+    std::unordered_map<std::string, ButtonInstance> buttonInstances;
+
+    /**
+     * @brief The current debug host selector button press is a long press
+     */
+    bool debugHSLongPressHandled = false;
+
+    /**
+     * @brief The running "all hosts" action, if any
+     */
+    std::optional<AllHostsRequest> allHosts;
+
+    /**
+     * @brief Delays the next host transition of an "all hosts" action
+     */
+    EventSourcePtr allHostsTimer;
 };
 
 } // namespace button
@@ -1,10 +1,83 @@
 #pragma once
+#include "config.h"
 
+#include "button_stats.hpp"
 #include "common.hpp"
+#include "edge_decoder.hpp"
+#include "edge_event.hpp"
+#include "edge_journal.hpp"
+#include "edge_trace.hpp"
 #include "gpio.hpp"
+#include "gpio_backend.hpp"
+#include "gpio_poller.hpp"
+#include "log_limiter.hpp"
+#include "probes.hpp"
+#include "state_page.hpp"
 #include "xyz/openbmc_project/Chassis/Common/error.hpp"
+#include "xyz/openbmc_project/State/Decorator/OperationalStatus/server.hpp"
 
 #include <phosphor-logging/elog-errors.hpp>
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <optional>
+
+// backoff used to re-open a gpio line after a read error
+constexpr uint64_t gpioRetryMinUsec = 100 * 1000;
+constexpr uint64_t gpioRetryMaxUsec = 60 * 1000 * 1000;
+// time a re-opened gpio line has to stay up for its backoff to start over
+constexpr uint64_t gpioStableUsec = 60 * 1000 * 1000;
+
+/**
+ * Backoff of the re-opens of a failing gpio line. The delay doubles on each
+ * failure, of a re-open or of a read, up to gpioRetryMaxUsec. It only starts
+ * over from gpioRetryMinUsec once the line stayed up for gpioStableUsec, so a
+ * line which fails again right after it is re-opened is retried less and less
+ * often.
+ */
+struct GpioBackoff
+{
+    uint64_t delay = gpioRetryMinUsec;
+    // time the line was re-opened at, empty while it is down
+    std::optional<uint64_t> upSinceUsec;
+
+    /**
+     * @brief called when the line fails at nowUsec
+     * @return the delay until the next re-open
+     */
+    uint64_t failed(uint64_t nowUsec)
+    {
+        if (!upSinceUsec || (nowUsec - *upSinceUsec >= gpioStableUsec))
+        {
+            delay = gpioRetryMinUsec;
+        }
+        else
+        {
+            delay = std::min(delay * 2, gpioRetryMaxUsec);
+        }
+        upSinceUsec.reset();
+        return delay;
+    }
+
+    /**
+     * @brief called when a re-open fails
+     * @return the delay until the next re-open
+     */
+    uint64_t reopenFailed()
+    {
+        delay = std::min(delay * 2, gpioRetryMaxUsec);
+        return delay;
+    }
+
+    void reopened(uint64_t nowUsec)
+    {
+        upSinceUsec = nowUsec;
+    }
+};
+
+using OperationalStatusObject = sdbusplus::server::object_t<
+    sdbusplus::xyz::openbmc_project::State::Decorator::server::
+        OperationalStatus>;
 // This is the base class for all the button interface types
 //
 class ButtonIface
@@ -22,13 +95,33 @@ class ButtonIface
 
         if (ret < 0)
         {
-            phosphor::logging::log<phosphor::logging::level::ERR>(
-                (getFormFactorType() + " : failed to config GPIO").c_str());
+            lg2::error("{TYPE}: failed to config GPIO", "TYPE",
+                       config.formFactorName);
             throw sdbusplus::xyz::openbmc_project::Chassis::Common::Error::
                 IOError();
         }
+
+        for (const auto& gpio : config.gpios)
+        {
+            decoders.push_back(getGpioLevelDecoder(gpio.polarity));
+        }
+
+        if (!config.dbusObjectPath.empty())
+        {
+            operationalStatus = std::make_unique<OperationalStatusObject>(
+                bus, config.dbusObjectPath.c_str());
+            operationalStatus->functional(true, true);
+            stats = std::make_unique<ButtonStats>(
+                bus, event, config.dbusObjectPath.c_str(), config.gpios.size());
+        }
+    }
+    virtual ~ButtonIface()
+    {
+        for (size_t index = 0; index < config.gpios.size(); index++)
+        {
+            GpioPoller::instance().remove(this, index);
+        }
     }
-    virtual ~ButtonIface() {}
 
     /**
      * @brief This method is called from sd-event provided callback function
@@ -44,7 +137,20 @@ class ButtonIface
         if (userdata)
         {
             ButtonIface* buttonIface = static_cast<ButtonIface*>(userdata);
+            BUTTONS_PROBE(handle_event,
+                          buttonIface->config.formFactorName.c_str(), fd,
+                          revents);
             buttonIface->handleEvent(es, fd, revents);
+            BUTTONS_PROBE(handle_event_done,
+                          buttonIface->config.formFactorName.c_str(), fd);
+
+            // the signals of the edge have been queued on the bus by now
+            if (buttonIface->stats && (buttonIface->edgeUsec != 0))
+            {
+                buttonIface->stats->recordSignalLatency(getMonotonicUsec() -
+                                                        buttonIface->edgeUsec);
+            }
+            buttonIface->edgeUsec = 0;
         }
 
         return 0;
@@ -55,6 +161,54 @@ class ButtonIface
         return config.formFactorName;
     }
 
+    /**
+     * @brief returns the D-Bus object path of the button instance, empty if
+     * it is not on D-Bus
+     */
+    const std::string& getObjectPath() const
+    {
+        return config.dbusObjectPath;
+    }
+
+    /**
+     * @brief handles an edge of the gpio at the given index as if it was
+     * read from the line, through the io event handler of the button
+     */
+    void feedEdge(size_t index, const GpioEdge& edge)
+    {
+        pendingEdge = edge;
+        callbackHandler(nullptr, config.gpios[index].fd, 0, this);
+        pendingEdge.reset();
+    }
+
+    /**
+     * @brief takes the gpio at the given index out of the event loop after
+     * a read error, see gpioFailed()
+     */
+    void failGpio(size_t index)
+    {
+        gpioFailed(config.gpios[index].fd);
+    }
+
+#if EDGE_INJECTION_ENABLED
+    /**
+     * @brief feeds an injected edge of the gpio at the given index
+     * @return the handling time in microseconds, empty if the gpio is not
+     * in the event loop
+     */
+    std::optional<uint64_t> injectEdge(size_t index, const GpioEdge& edge)
+    {
+        if ((index >= config.gpios.size()) || (config.gpios[index].fd < 0))
+        {
+            return std::nullopt;
+        }
+
+        uint64_t start = getMonotonicUsec();
+        feedEdge(index, edge);
+        return getMonotonicUsec() - start;
+    }
+#endif
+
   protected:
     /**
      * @brief oem specific initialization can be done under init function.
@@ -67,31 +221,268 @@ class ButtonIface
     {
         // initialize the button io fd from the buttonConfig
         // which has fd stored when configGroupGpio is called
-        for (auto gpioCfg : config.gpios)
+        eventSources.resize(config.gpios.size());
+        for (size_t index = 0; index < config.gpios.size(); index++)
         {
-            char buf;
-            int fd = gpioCfg.fd;
+            int fd = config.gpios[index].fd;
 
-            int ret = ::read(fd, &buf, sizeof(buf));
-            if (ret < 0)
+            if (addGpioSource(index) < 0)
+            {
+                lg2::error("{TYPE}: failed to add to event loop", "TYPE",
+                           config.formFactorName);
+                ::closeGpio(fd);
+                throw sdbusplus::xyz::openbmc_project::Chassis::Common::Error::
+                    IOError();
+            }
+        }
+    }
+
+    /**
+     * @brief clears the pending event of the gpio at the given index and
+     * adds its fd to the event loop.
+     * @return int returns 0 on success, negative errno otherwise
+     */
+    int addGpioSource(size_t index)
+    {
+        GpioEdge edge{};
+        int fd = config.gpios[index].fd;
+
+        // the level the line starts from, which also clears the pending
+        // event of the line
+        int ret = getGpioBackend().read(fd, edge);
+        if (ret < 0)
+        {
+            constexpr auto clearError = "{TYPE}: read error {RET}";
+            if (LogLimiter::instance().allow(config.gpios[index].number,
+                                             clearError))
+            {
+                lg2::error(clearError, "TYPE", config.formFactorName, "RET",
+                           ret);
+            }
+            if (config.gpios[index].polled)
             {
-                phosphor::logging::log<phosphor::logging::level::ERR>(
-                    (getFormFactorType() + " : read error!").c_str());
+                return ret;
             }
+        }
+        else
+        {
+            StatePage::instance().setLevel(config.formFactorName,
+                                           config.instance, index,
+                                           decoders[index](edge.high));
+        }
+
+        if (config.gpios[index].polled)
+        {
+            return GpioPoller::instance().add(
+                event, this, index, config.gpios[index], edge.high,
+                config.eventPriority.value_or(SD_EVENT_PRIORITY_NORMAL));
+        }
+
+        sd_event_source* source = nullptr;
+        ret = sd_event_add_io(event.get(), &source, fd,
+                              getGpioBackend().pollEvents(), callbackHandler,
+                              this);
+        if (ret < 0)
+        {
+            return ret;
+        }
+        eventSources[index].reset(source);
+
+        if (config.eventPriority)
+        {
+            sd_event_source_set_priority(source, *config.eventPriority);
+        }
+        return 0;
+    }
+
+    /**
+     * @brief takes a gpio line that failed to read out of the event loop and
+     * schedules re-opening it with an exponential backoff, so a single bad
+     * line does not take the other buttons down with it.
+     */
+    void gpioFailed(int fd)
+    {
+        auto it = std::find_if(
+            config.gpios.begin(), config.gpios.end(),
+            [fd](const auto& gpio) { return gpio.fd == fd; });
+        if (it == config.gpios.end())
+        {
+            return;
+        }
+        size_t index = std::distance(config.gpios.begin(), it);
+
+        if (gpioRecovery.empty())
+        {
+            gpioRecovery.resize(config.gpios.size());
+        }
+        auto& recovery = gpioRecovery[index];
+        recovery.iface = this;
+        recovery.index = index;
+
+        eventSources[index].reset();
+        GpioPoller::instance().remove(this, index);
+        ::closeGpio(fd);
+        it->fd = -1;
+
+        constexpr auto disableError =
+            "{TYPE}: disabling gpio-{NUM} after a read error";
+        if (LogLimiter::instance().allow(it->number, disableError))
+        {
+            lg2::error(disableError, "TYPE", config.formFactorName, "NUM",
+                       it->number);
+        }
+        journalAction(index, EdgeAction::readError);
+        if (operationalStatus)
+        {
+            operationalStatus->functional(false);
+        }
+
+        uint64_t now = 0;
+        sd_event_now(event.get(), CLOCK_MONOTONIC, &now);
+        recovery.backoff.failed(now);
+        scheduleGpioRetry(recovery);
+    }
+
+    /**
+     * @brief returns the index of the gpio with the given fd in the button
+     * config, config.gpios.size() if there is none
+     */
+    size_t findGpioIndex(int fd) const
+    {
+        size_t index = 0;
+        while ((index < config.gpios.size()) && (config.gpios[index].fd != fd))
+        {
+            index++;
+        }
+        return index;
+    }
+
+    /**
+     * @brief reads the pending edge of a gpio from the gpio backend and
+     * decodes it with the polarity of the line. The edge is reported to the
+     * edge listeners before it is returned. A read error is logged and the
+     * line is handed to gpioFailed().
+     * @return the decoded edge, empty on a read error
+     */
+    std::optional<EdgeEvent> readEdge(int fd)
+    {
+        size_t index = findGpioIndex(fd);
+        if (index == config.gpios.size())
+        {
+            return std::nullopt;
+        }
 
-            ret = sd_event_add_io(event.get(), nullptr, fd, EPOLLPRI,
-                                  callbackHandler, this);
+        GpioEdge edge{};
+        if (pendingEdge)
+        {
+            edge = *pendingEdge;
+        }
+        else
+        {
+            int ret = getGpioBackend().read(fd, edge);
             if (ret < 0)
             {
-                phosphor::logging::log<phosphor::logging::level::ERR>(
-                    (getFormFactorType() + " : failed to add to event loop")
-                        .c_str());
-                ::closeGpio(fd);
-                throw sdbusplus::xyz::openbmc_project::Chassis::Common::Error::
-                    IOError();
+                constexpr auto readError = "{TYPE}: gpio read error: {RET}";
+                if (LogLimiter::instance().allow(config.gpios[index].number,
+                                                 readError))
+                {
+                    lg2::error(readError, "TYPE", config.formFactorName,
+                               "RET", ret);
+                }
+                gpioFailed(fd);
+                return std::nullopt;
             }
+            EdgeTrace::instance().record(config.gpios[index].number, edge);
+        }
+
+        // an edge stamped after the long press time ran out, ahead of the
+        // loop clock or with the loop busy, comes after the long press
+        runTimerIfDue(longPressTimer.get(), edge.timestamp, longPressHandler,
+                      this);
+
+        EdgeEvent decoded{config.formFactorName, config.instance, index,
+                          decoders[index](edge.high), edge.timestamp};
+        notifyEdge(decoded);
+        edgeUsec = edge.synthetic ? 0 : edge.timestamp;
+        return decoded;
+    }
+
+    /**
+     * @brief reports a decoded edge to the edge listeners, with the
+     * timestamp given by the gpio backend.
+     */
+    void notifyEdge(const EdgeEvent& edge)
+    {
+        EdgeJournal::instance().record(config.formFactorName, edge.line,
+                                       edge.state, EdgeAction::edge,
+                                       edge.timestamp);
+        if (stats)
+        {
+            stats->update(edge.line, edge.state, edge.timestamp);
         }
+        EdgeDispatcher::instance().dispatch(edge);
+    }
+
+    /**
+     * @brief records an event of the gpio at the given index, other than
+     * an edge, in the edge journal
+     */
+    void journalAction(size_t index, EdgeAction action)
+    {
+        uint64_t now = 0;
+        sd_event_now(event.get(), CLOCK_MONOTONIC, &now);
+        EdgeJournal::instance().record(config.formFactorName, index,
+                                       GpioState::invalid, action, now);
     }
+
+    /**
+     * @brief arms a one shot timer which calls longPressed() once the
+     * button has been held for LONG_PRESS_TIME_MS from the press edge at
+     * pressUsec, so a long press can be acted upon while the button is still
+     * held.
+     */
+    void startLongPressTimer(uint64_t pressUsec)
+    {
+        uint64_t expiry = pressUsec + LONG_PRESS_TIME_MS * 1000ULL;
+
+        if (longPressTimer)
+        {
+            sd_event_source_set_time(longPressTimer.get(), expiry);
+            sd_event_source_set_enabled(longPressTimer.get(), SD_EVENT_ONESHOT);
+            return;
+        }
+
+        sd_event_source* timer = nullptr;
+        int ret = sd_event_add_time(event.get(), &timer, CLOCK_MONOTONIC,
+                                    expiry, 0, longPressHandler, this);
+        if (ret < 0)
+        {
+            lg2::error("{TYPE}: failed to arm long press timer: {RET}", "TYPE",
+                       config.formFactorName, "RET", ret);
+            return;
+        }
+        longPressTimer.reset(timer);
+    }
+
+    void stopLongPressTimer()
+    {
+        if (longPressTimer)
+        {
+            sd_event_source_set_enabled(longPressTimer.get(), SD_EVENT_OFF);
+        }
+    }
+
+    /**
+     * @brief called when the long press timer expires
+     */
+    virtual void longPressed() {}
+
+    /**
+     * @brief called once a failed gpio line is back in the event loop, a
+     * derived class can re-read its state here as edges may have been
+     * missed while the line was down.
+     */
+    virtual void gpioRecovered(size_t /* index */) {}
     /**
      * @brief similar to init() oem specific deinitialization can be done under
      * deInit function. if platform specific deinitialization is needed then a
@@ -100,6 +491,13 @@ class ButtonIface
      */
     virtual void deInit()
     {
+        for (size_t index = 0; index < config.gpios.size(); index++)
+        {
+            GpioPoller::instance().remove(this, index);
+        }
+        longPressTimer.reset();
+        gpioRecovery.clear();
+        eventSources.clear();
         for (auto gpioCfg : config.gpios)
         {
             ::closeGpio(gpioCfg.fd);
@@ -110,4 +508,93 @@ class ButtonIface
     EventPtr& event;
     buttonConfig config;
     sd_event_io_handler_t callbackHandler;
+    // io event sources of the gpios, in the order of config.gpios
+    std::vector<EventSourcePtr> eventSources;
+    std::unique_ptr<OperationalStatusObject> operationalStatus;
+    std::unique_ptr<ButtonStats> stats;
+    // level decoders of the gpios, in the order of config.gpios
+    std::vector<GpioLevelDecoder> decoders;
+
+  private:
+    struct gpioRetry
+    {
+        ButtonIface* iface = nullptr;
+        size_t index = 0;
+        GpioBackoff backoff;
+        EventSourcePtr timer;
+    };
+
+    static int longPressHandler(sd_event_source* /* es */,
+                                uint64_t /* usec */, void* userdata)
+    {
+        auto* self = static_cast<ButtonIface*>(userdata);
+        self->journalAction(0, EdgeAction::longPressed);
+        self->longPressed();
+        return 0;
+    }
+
+    void scheduleGpioRetry(gpioRetry& recovery)
+    {
+        uint64_t now = 0;
+        sd_event_now(event.get(), CLOCK_MONOTONIC, &now);
+
+        sd_event_source* timer = nullptr;
+        int ret = sd_event_add_time(event.get(), &timer, CLOCK_MONOTONIC,
+                                    now + recovery.backoff.delay, 0,
+                                    ButtonIface::gpioRetryHandler, &recovery);
+        if (ret < 0)
+        {
+            lg2::error("{TYPE}: failed to schedule gpio re-open: {RET}", "TYPE",
+                       config.formFactorName, "RET", ret);
+            return;
+        }
+        recovery.timer.reset(timer);
+    }
+
+    static int gpioRetryHandler(sd_event_source* /* es */, uint64_t /* usec */,
+                                void* userdata)
+    {
+        auto& recovery = *static_cast<gpioRetry*>(userdata);
+        auto& self = *recovery.iface;
+        auto& gpio = self.config.gpios[recovery.index];
+
+        recovery.timer.reset();
+        if (::configGpio(gpio) < 0 || self.addGpioSource(recovery.index) < 0)
+        {
+            ::closeGpio(gpio.fd);
+            gpio.fd = -1;
+            recovery.backoff.reopenFailed();
+            self.scheduleGpioRetry(recovery);
+            return 0;
+        }
+
+        constexpr auto reopened = "{TYPE}: gpio-{NUM} re-opened";
+        if (LogLimiter::instance().allow(gpio.number, reopened))
+        {
+            lg2::info(reopened, "TYPE", self.config.formFactorName, "NUM",
+                      gpio.number);
+        }
+        uint64_t now = 0;
+        sd_event_now(self.event.get(), CLOCK_MONOTONIC, &now);
+        recovery.backoff.reopened(now);
+        self.journalAction(recovery.index, EdgeAction::recovered);
+
+        bool allLinesUp = std::all_of(
+            self.config.gpios.begin(), self.config.gpios.end(),
+            [](const auto& gpio) { return gpio.fd >= 0; });
+        if (self.operationalStatus && allLinesUp)
+        {
+            self.operationalStatus->functional(true);
+        }
+        self.gpioRecovered(recovery.index);
+        return 0;
+    }
+
+    std::vector<gpioRetry> gpioRecovery;
+    EventSourcePtr longPressTimer;
+    // timestamp of the edge reported by the event being handled, 0 if its
+    // latency is not recorded
+    uint64_t edgeUsec = 0;
+    // edge handed to readEdge() instead of reading the line
+    std::optional<GpioEdge> pendingEdge;
 };
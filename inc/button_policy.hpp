@@ -0,0 +1,179 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace phosphor
+{
+namespace button
+{
+
+enum class PolicyButton
+{
+    power,
+    reset,
+    count
+};
+
+enum class PolicyGesture
+{
+    press,
+    longPress,
+    count
+};
+
+// what the host selector points to on a multi-host system, a single host
+// system is always at the host position
+enum class PolicySelector
+{
+    host,
+    bmc,
+    count
+};
+
+enum class PolicyHostState
+{
+    off,
+    on,
+    count
+};
+
+enum class PolicyAction
+{
+    none,
+    hostOn,
+    hostOff,
+    hostReboot,
+    chassisOn,
+    chassisOff,
+    chassisPowerCycle,
+    chassisSystemPowerCycle,
+    // the host transition is sent to every host of a multi-host system
+    allHostsOn,
+    allHostsOff,
+    allHostsReboot
+};
+
+/**
+ * @brief Limits of an "all hosts" action, so that powering on all the hosts
+ * together does not overload the power supplies
+ */
+struct FanOutConfig
+{
+    // number of host transitions in flight at once, 0 for no limit
+    size_t maxConcurrent = 0;
+    // minimum time between the start of two host transitions
+    uint64_t staggerMs = 0;
+};
+
+/**
+ * @class ButtonPolicy
+ *
+ * Maps a (button, gesture, selector position, host state) tuple to the power
+ * action to take. The built-in defaults can be overridden by the "policy"
+ * array of a json file, where each rule sets the action of all the matching
+ * entries and "any" matches every value of a field:
+ *
+ * {
+ *   "button": "power",
+ *   "gesture": "long_press",
+ *   "selector": "any",
+ *   "host_state": "on",
+ *   "action": "chassis_off"
+ * }
+ *
+ * The rules are compiled into a dense table at startup, so picking an
+ * action is a single lookup. The optional "fan_out" object limits the
+ * "all_hosts_*" actions:
+ *
+ * "fan_out": { "max_concurrent": 2, "stagger_ms": 500 }
+ */
+class ButtonPolicy
+{
+  public:
+    ButtonPolicy();
+
+    /**
+     * @brief applies the rules of a policy json file on top of the
+     * current table, an invalid rule is logged and skipped
+     *
+     * @param[in] policyJson - json object with a "policy" array
+     */
+    void load(const nlohmann::json& policyJson);
+
+    /**
+     * @brief returns the action for the given state
+     */
+    PolicyAction lookup(PolicyButton button, PolicyGesture gesture,
+                        PolicySelector selector,
+                        PolicyHostState hostState) const
+    {
+        return table[index(button, gesture, selector, hostState)];
+    }
+
+    /**
+     * @brief checks whether the action differs between host states, when
+     * it does not the host state does not need to be read at all
+     */
+    bool dependsOnHostState(PolicyButton button, PolicyGesture gesture,
+                            PolicySelector selector) const
+    {
+        return lookup(button, gesture, selector, PolicyHostState::off) !=
+               lookup(button, gesture, selector, PolicyHostState::on);
+    }
+
+    /**
+     * @brief returns the limits of the "all hosts" actions
+     */
+    const FanOutConfig& getFanOutConfig() const
+    {
+        return fanOut;
+    }
+
+  private:
+    static constexpr size_t buttonCount =
+        static_cast<size_t>(PolicyButton::count);
+    static constexpr size_t gestureCount =
+        static_cast<size_t>(PolicyGesture::count);
+    static constexpr size_t selectorCount =
+        static_cast<size_t>(PolicySelector::count);
+    static constexpr size_t hostStateCount =
+        static_cast<size_t>(PolicyHostState::count);
+
+    static constexpr size_t index(PolicyButton button, PolicyGesture gesture,
+                                  PolicySelector selector,
+                                  PolicyHostState hostState)
+    {
+        return ((static_cast<size_t>(button) * gestureCount +
+                 static_cast<size_t>(gesture)) *
+                    selectorCount +
+                static_cast<size_t>(selector)) *
+                   hostStateCount +
+               static_cast<size_t>(hostState);
+    }
+
+    void set(PolicyButton button, PolicyGesture gesture,
+             PolicySelector selector, PolicyHostState hostState,
+             PolicyAction action)
+    {
+        table[index(button, gesture, selector, hostState)] = action;
+    }
+
+    std::array<PolicyAction,
+               buttonCount * gestureCount * selectorCount * hostStateCount>
+        table{};
+
+    FanOutConfig fanOut;
+};
+
+/**
+ * @brief returns the name of an action for logging
+ */
+std::string getActionName(PolicyAction action);
+
+} // namespace button
+} // namespace phosphor
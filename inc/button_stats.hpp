@@ -0,0 +1,111 @@
+#pragma once
+
+#include "common.hpp"
+#include "gpio.hpp"
+#include "latency_histogram.hpp"
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/server/interface.hpp>
+
+#include <bitset>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// an edge closer than this to the previous edge of the same line, or an
+// edge which does not change the level, is counted as a bounce. The first
+// edge of a line has nothing to bounce from.
+constexpr uint64_t bounceWindowUsec = 20 * 1000;
+
+// the properties of a button signal their changes at most this often
+constexpr uint64_t statsEmitIntervalUsec = 1000 * 1000;
+
+/**
+ * @class ButtonStats
+ *
+ * Read-only Statistics properties of a button object, updated from the
+ * gpio edges: the current level of the lines, the press and bounce counts,
+ * the last press duration and the last edge time, along with the latency
+ * from an edge to its D-Bus signal and the peak edge rate. Changes are
+ * batched in one PropertiesChanged signal per statsEmitIntervalUsec, so
+ * that a bouncing line cannot flood the bus.
+ */
+class ButtonStats
+{
+  public:
+    ButtonStats() = delete;
+    ButtonStats(const ButtonStats&) = delete;
+    ButtonStats& operator=(const ButtonStats&) = delete;
+    ButtonStats(ButtonStats&&) = delete;
+    ButtonStats& operator=(ButtonStats&&) = delete;
+
+    ButtonStats(sdbusplus::bus_t& bus, EventPtr& event, const char* path,
+                size_t lineCount);
+
+    /**
+     * @brief accounts a gpio edge
+     */
+    void update(size_t line, GpioState state, uint64_t timestamp);
+
+    /**
+     * @brief accounts the time from an edge to its D-Bus signal
+     */
+    void recordSignalLatency(uint64_t usec);
+
+    /**
+     * @brief sd-bus getter of the properties
+     */
+    static int getProperty(sd_bus* bus, const char* path,
+                           const char* interface, const char* property,
+                           sd_bus_message* reply, void* userdata,
+                           sd_bus_error* error);
+
+  private:
+    enum Property
+    {
+        level,
+        pressCount,
+        bounceCount,
+        lastPressDuration,
+        lastEdgeTime,
+        signalLatencyP50,
+        signalLatencyP99,
+        signalLatencyMax,
+        peakEdgeRate,
+        propertyCount
+    };
+
+    // batches the changes on the loop clock, the edge timestamps of an
+    // injected or replayed edge are not the time it is handled at
+    void scheduleEmit();
+    void emitChanged();
+
+    static int emitHandler(sd_event_source* es, uint64_t usec,
+                           void* userdata);
+
+    sdbusplus::bus_t& bus;
+    EventPtr& event;
+    std::string path;
+    sdbusplus::server::interface_t statsIface;
+    EventSourcePtr emitTimer;
+    std::bitset<propertyCount> dirty;
+    uint64_t lastEmitUsec = 0;
+
+    // bit n is set while gpio n is asserted
+    uint32_t levels = 0;
+    uint64_t presses = 0;
+    uint64_t bounces = 0;
+    uint64_t lastPressUsec = 0;
+    uint64_t lastEdgeUsec = 0;
+    LatencyHistogram latency;
+    // edges seen in the current one second window, and the most seen in
+    // any window
+    uint64_t rateWindowUsec = 0;
+    uint64_t rateWindowEdges = 0;
+    uint64_t peakRate = 0;
+    // per line edge timestamp of the last edge and of the last assert,
+    // empty until the line had one
+    std::vector<std::optional<uint64_t>> edgeTimes;
+    std::vector<std::optional<uint64_t>> pressTimes;
+};
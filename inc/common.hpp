@@ -18,7 +18,9 @@
 
 #include <systemd/sd-event.h>
 
+#include <cstdint>
 #include <memory>
+#include <string_view>
 
 struct EventDeleter
 {
@@ -28,3 +30,69 @@ struct EventDeleter
     }
 };
 using EventPtr = std::unique_ptr<sd_event, EventDeleter>;
+
+struct EventSourceDeleter
+{
+    void operator()(sd_event_source* source) const
+    {
+        sd_event_source_unref(source);
+    }
+};
+using EventSourcePtr = std::unique_ptr<sd_event_source, EventSourceDeleter>;
+
+// sd-event priority classes of the gpio event sources, a lower value is
+// dispatched first. All of them are ahead of the D-Bus connection which is
+// attached at SD_EVENT_PRIORITY_NORMAL unless configured otherwise.
+constexpr int64_t eventPriorityHigh = SD_EVENT_PRIORITY_IMPORTANT;
+constexpr int64_t eventPriorityNormal = SD_EVENT_PRIORITY_IMPORTANT / 2;
+constexpr int64_t eventPriorityLow = SD_EVENT_PRIORITY_IMPORTANT / 10;
+
+/**
+ * @brief maps a priority class name from the gpio defs json file
+ * ("high", "normal", "low" or "bus") to its sd-event priority value
+ * @return int64_t the priority, or defaultPriority for an unknown name
+ */
+inline int64_t getEventPriority(std::string_view className,
+                                int64_t defaultPriority)
+{
+    if (className == "high")
+    {
+        return eventPriorityHigh;
+    }
+    if (className == "normal")
+    {
+        return eventPriorityNormal;
+    }
+    if (className == "low")
+    {
+        return eventPriorityLow;
+    }
+    if (className == "bus")
+    {
+        return SD_EVENT_PRIORITY_NORMAL;
+    }
+    return defaultPriority;
+}
+
+/**
+ * @brief runs a one shot timer at once when it was due by the given time.
+ * The edges of a fast trace replay are stamped ahead of the loop clock, the
+ * timers armed from them are caught up with the edges which follow.
+ * @return true if the timer was due and ran
+ */
+inline bool runTimerIfDue(sd_event_source* timer, uint64_t usec,
+                          sd_event_time_handler_t handler, void* userdata)
+{
+    int enabled = SD_EVENT_OFF;
+    uint64_t due = 0;
+    if ((timer == nullptr) ||
+        (sd_event_source_get_enabled(timer, &enabled) < 0) ||
+        (enabled == SD_EVENT_OFF) ||
+        (sd_event_source_get_time(timer, &due) < 0) || (due > usec))
+    {
+        return false;
+    }
+    sd_event_source_set_enabled(timer, SD_EVENT_OFF);
+    handler(timer, due, userdata);
+    return true;
+}
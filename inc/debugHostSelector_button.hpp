@@ -44,6 +44,7 @@ class DebugHostSelector final :
     void simRelease() override;
     void simLongPress() override;
     void handleEvent(sd_event_source* es, int fd, uint32_t revents) override;
+    void longPressed() override;
 
     static constexpr std::string_view getFormFactorName()
     {
@@ -54,4 +55,9 @@ class DebugHostSelector final :
     {
         return DBG_HS_DBUS_OBJECT_NAME;
     }
+
+    static constexpr int64_t getDefaultEventPriority()
+    {
+        return eventPriorityNormal;
+    }
 };
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "gpio.hpp"
+
+/**
+ * @brief decodes the raw level of a line into its state, resolved at
+ * compile time for each polarity
+ */
+template <GpioPolarity polarity>
+constexpr GpioState decodeGpioLevel(bool high)
+{
+    if constexpr (polarity == GpioPolarity::activeHigh)
+    {
+        return high ? GpioState::assert : GpioState::deassert;
+    }
+    else
+    {
+        return high ? GpioState::deassert : GpioState::assert;
+    }
+}
+
+using GpioLevelDecoder = GpioState (*)(bool high);
+
+/**
+ * @brief returns the decoder of a line, picked once when the line is
+ * configured so that decoding an edge does not look at the config
+ */
+constexpr GpioLevelDecoder getGpioLevelDecoder(GpioPolarity polarity)
+{
+    return (polarity == GpioPolarity::activeHigh)
+               ? decodeGpioLevel<GpioPolarity::activeHigh>
+               : decodeGpioLevel<GpioPolarity::activeLow>;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "gpio.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+// a decoded gpio edge as seen by the button interfaces
+struct EdgeEvent
+{
+    std::string_view button; // form factor name of the button interface
+    size_t instance;         // instance index of the button, see
+                             // ButtonFactory::getInstanceIndex()
+    size_t line;             // index of the gpio in buttonConfig.gpios
+    GpioState state;         // new state of the line
+    uint64_t timestamp;      // CLOCK_MONOTONIC, in microseconds
+};
+
+/**
+ * @brief fans the gpio edges reported by the button interfaces out to the
+ * components which need the raw edge stream, such as the gesture engine.
+ */
+
+class EdgeDispatcher
+{
+  public:
+    using Listener = std::function<void(const EdgeEvent&)>;
+
+    static EdgeDispatcher& instance()
+    {
+        static EdgeDispatcher edgeDispatcherObj;
+        return edgeDispatcherObj;
+    }
+
+    void addListener(Listener listener)
+    {
+        listeners.emplace_back(std::move(listener));
+    }
+
+    void dispatch(const EdgeEvent& edge) const
+    {
+        for (const auto& listener : listeners)
+        {
+            listener(edge);
+        }
+    }
+
+  private:
+    std::vector<Listener> listeners;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "button_interface.hpp"
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/server/interface.hpp>
+
+#include <memory>
+#include <vector>
+
+// edges accepted by a single InjectEdges call, so that a call cannot hold
+// the event loop for long
+constexpr size_t edgeInjectorMaxBatch = 4096;
+
+// oldest edge timestamp accepted, relative to the time of the call. The
+// timestamps drive the gesture timers and the latency statistics, which
+// expect edges from the recent past.
+constexpr uint64_t edgeInjectorMaxAgeUsec = 60 * 1000 * 1000;
+
+/**
+ * @class EdgeInjector
+ *
+ * Serves the InjectEdges diagnostic method, which feeds a batch of raw
+ * edges (line, level, timestamp) of the button instance at the given
+ * object path through its event handler as if they were read from the gpio
+ * lines. The edges go through the same decoding, signals, gestures and
+ * listeners as real ones, and the method returns the time each of them took
+ * to handle, in microseconds. A timestamp of 0 stands for the time of
+ * injection, other timestamps must not be in the future nor older than
+ * edgeInjectorMaxAgeUsec, or the whole batch is rejected. Injected edges
+ * are left out of the latency statistics of the button.
+ */
+class EdgeInjector
+{
+  public:
+    EdgeInjector() = delete;
+    EdgeInjector(const EdgeInjector&) = delete;
+    EdgeInjector& operator=(const EdgeInjector&) = delete;
+    EdgeInjector(EdgeInjector&&) = delete;
+    EdgeInjector& operator=(EdgeInjector&&) = delete;
+
+    EdgeInjector(sdbusplus::bus_t& bus, const char* path,
+                 std::vector<std::unique_ptr<ButtonIface>>& buttons);
+
+    /**
+     * @brief sd-bus handler of the InjectEdges method
+     */
+    static int injectHandler(sd_bus_message* msg, void* userdata,
+                             sd_bus_error* error);
+
+  private:
+    std::vector<std::unique_ptr<ButtonIface>>& buttons;
+    sdbusplus::server::interface_t injectorIface;
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "gpio.hpp"
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/server/interface.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+constexpr size_t edgeJournalSize = 256;
+
+// what the daemon did for a journal entry
+enum class EdgeAction : uint8_t
+{
+    edge,        // the gpio changed, the pressed/released signal was sent
+    longPressed, // the long press time elapsed while the button was held
+    readError,   // the gpio could not be read and was taken out of the loop
+    recovered    // the gpio was re-opened after a read error
+};
+
+struct EdgeJournalEntry
+{
+    uint64_t timestamp;  // CLOCK_MONOTONIC, in microseconds
+    const char* button;  // form factor name, lives as long as the button
+    uint32_t line;       // index of the gpio in the button config
+    GpioState state;     // level of the line, invalid if not an edge
+    EdgeAction action;
+};
+
+/**
+ * @class EdgeJournal
+ *
+ * Keeps the last edgeJournalSize raw gpio events in a fixed ring, so that
+ * what happened to a button can be looked at after the fact without any
+ * debug logging. Recording an event is a store into the ring, the ring is
+ * dumped over D-Bus and written to EDGE_JOURNAL_FILE if the daemon crashes.
+ */
+class EdgeJournal
+{
+  public:
+    EdgeJournal(const EdgeJournal&) = delete;
+    EdgeJournal& operator=(const EdgeJournal&) = delete;
+    EdgeJournal(EdgeJournal&&) = delete;
+    EdgeJournal& operator=(EdgeJournal&&) = delete;
+
+    static EdgeJournal& instance()
+    {
+        static EdgeJournal edgeJournalObj;
+        return edgeJournalObj;
+    }
+
+    /**
+     * @brief records an event, called from the event loop only
+     */
+    void record(std::string_view button, size_t line, GpioState state,
+                EdgeAction action, uint64_t timestamp)
+    {
+        auto index = next.load(std::memory_order_relaxed);
+        entries[index % edgeJournalSize] = {timestamp, button.data(),
+                                            static_cast<uint32_t>(line), state,
+                                            action};
+        next.store(index + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief calls func on the recorded entries, oldest first
+     */
+    template <typename Func>
+    void forEach(Func&& func) const
+    {
+        auto end = next.load(std::memory_order_acquire);
+        auto begin = (end > edgeJournalSize) ? (end - edgeJournalSize) : 0;
+        for (auto index = begin; index < end; index++)
+        {
+            func(entries[index % edgeJournalSize]);
+        }
+    }
+
+    /**
+     * @brief writes the journal to the file when the daemon gets a fatal
+     * signal, the signal is then raised again
+     */
+    void installCrashHandler(const char* path);
+
+  private:
+    EdgeJournal() = default;
+
+    static void crashHandler(int signal);
+
+    std::array<EdgeJournalEntry, edgeJournalSize> entries{};
+    std::atomic<uint64_t> next = 0;
+    const char* crashFile = nullptr;
+};
+
+/**
+ * @brief returns the name of a journal action
+ */
+const char* getEdgeActionName(EdgeAction action);
+
+/**
+ * @class EdgeJournalDump
+ *
+ * Serves the Dump method, which returns the journal entries as an array of
+ * (timestamp, button, line, asserted, action).
+ */
+class EdgeJournalDump
+{
+  public:
+    EdgeJournalDump() = delete;
+    EdgeJournalDump(const EdgeJournalDump&) = delete;
+    EdgeJournalDump& operator=(const EdgeJournalDump&) = delete;
+    EdgeJournalDump(EdgeJournalDump&&) = delete;
+    EdgeJournalDump& operator=(EdgeJournalDump&&) = delete;
+
+    EdgeJournalDump(sdbusplus::bus_t& bus, const char* path);
+
+    /**
+     * @brief sd-bus handler of the Dump method
+     */
+    static int dumpHandler(sd_bus_message* msg, void* userdata,
+                           sd_bus_error* error);
+
+  private:
+    sdbusplus::server::interface_t dumpIface;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "common.hpp"
+#include "edge_event.hpp"
+
+#include <array>
+#include <cstdint>
+#include <list>
+
+constexpr size_t edgeSocketMaxSubscribers = 8;
+constexpr size_t edgeSocketRingSize = 64;
+
+// one SOCK_SEQPACKET message per gpio edge
+struct EdgeSocketRecord
+{
+    uint64_t timestamp;  // CLOCK_MONOTONIC, in microseconds
+    uint64_t sequence;   // edge number, a gap shows dropped records
+    char button[32];     // form factor name, NUL terminated
+    uint32_t line;       // index of the gpio in the button config
+    uint32_t level;      // 1 if asserted, 0 if deasserted
+    uint32_t overflows;  // records dropped for this subscriber so far
+    uint32_t instance;   // instance index of the button, 2 for Power2
+};
+
+/**
+ * @class EdgeSocket
+ *
+ * Streams the gpio edges to local subscribers over a Unix SOCK_SEQPACKET
+ * socket, for consumers which cannot afford the latency of the D-Bus
+ * signals. The sockets are never written in a blocking way: a subscriber
+ * which does not keep up gets its records queued in a small ring, and
+ * dropped once the ring is full.
+ */
+class EdgeSocket
+{
+  public:
+    EdgeSocket() = delete;
+    EdgeSocket(const EdgeSocket&) = delete;
+    EdgeSocket& operator=(const EdgeSocket&) = delete;
+    EdgeSocket(EdgeSocket&&) = delete;
+    EdgeSocket& operator=(EdgeSocket&&) = delete;
+
+    /**
+     * @brief listens on the socket path, errors are logged and leave the
+     * socket disabled
+     */
+    EdgeSocket(EventPtr& event, const char* path);
+    ~EdgeSocket();
+
+    /**
+     * @brief sends a gpio edge to all the subscribers
+     */
+    void handleEdge(const EdgeEvent& edge);
+
+  private:
+    struct Subscriber
+    {
+        EdgeSocket* socket;
+        int fd;
+        EventSourcePtr source;
+        std::array<EdgeSocketRecord, edgeSocketRingSize> ring;
+        size_t head = 0;
+        size_t count = 0;
+        uint32_t overflows = 0;
+    };
+
+    void queue(Subscriber& subscriber, EdgeSocketRecord& record);
+    bool flush(Subscriber& subscriber);
+    void removeSubscriber(Subscriber& subscriber);
+
+    static int acceptHandler(sd_event_source* es, int fd, uint32_t revents,
+                             void* userdata);
+    static int subscriberHandler(sd_event_source* es, int fd,
+                                 uint32_t revents, void* userdata);
+
+    EventPtr& event;
+    int listenFd = -1;
+    EventSourcePtr listenSource;
+    std::list<Subscriber> subscribers;
+    uint64_t sequence = 0;
+};
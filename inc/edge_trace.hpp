@@ -0,0 +1,128 @@
+#pragma once
+
+#include "common.hpp"
+#include "gpio.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Layout of an edge trace file: an EdgeTraceHeader followed by one
+ * EdgeTraceRecord per raw gpio edge, in the order they were read. The
+ * fields are in the byte order of the BMC which recorded the trace.
+ */
+constexpr uint32_t edgeTraceMagic = 0x43525442; // "BTRC"
+constexpr uint32_t edgeTraceVersion = 1;
+
+struct EdgeTraceHeader
+{
+    uint32_t magic;
+    uint32_t version;
+};
+
+struct EdgeTraceRecord
+{
+    uint64_t timestamp; // CLOCK_MONOTONIC, in microseconds
+    uint32_t number;    // gpio number
+    uint32_t high;      // raw level of the line
+};
+
+static_assert(sizeof(EdgeTraceRecord) == 16);
+
+class SimGpioBackend;
+
+/**
+ * @class EdgeTrace
+ *
+ * Records the raw gpio edges read by the button interfaces to a trace file,
+ * with the timestamps given by the gpio backend. Each record is written as
+ * it comes, so a trace is complete up to the last edge even if the daemon
+ * is killed.
+ */
+class EdgeTrace
+{
+  public:
+    EdgeTrace(const EdgeTrace&) = delete;
+    EdgeTrace& operator=(const EdgeTrace&) = delete;
+    EdgeTrace(EdgeTrace&&) = delete;
+    EdgeTrace& operator=(EdgeTrace&&) = delete;
+
+    static EdgeTrace& instance()
+    {
+        static EdgeTrace edgeTraceObj;
+        return edgeTraceObj;
+    }
+
+    /**
+     * @brief creates the trace file and starts recording
+     * @return false if the file could not be created
+     */
+    bool open(const std::string& path);
+
+    bool enabled() const
+    {
+        return fd >= 0;
+    }
+
+    /**
+     * @brief appends an edge of the gpio with the given number
+     */
+    void record(uint32_t number, const GpioEdge& edge);
+
+  private:
+    EdgeTrace() = default;
+    ~EdgeTrace();
+
+    int fd = -1;
+};
+
+/**
+ * @class EdgeTraceReplay
+ *
+ * Feeds the edges of a trace file to the simulated gpio lines, either with
+ * the time between the edges of the trace or as fast as the daemon handles
+ * them. The edges keep the spacing of their trace timestamps, shifted to
+ * the start of the replay, so the edge driven logic sees the same sequence
+ * in both modes. In the fast mode the edges run ahead of the loop clock: the
+ * gesture timers armed from them are caught up with the edges which follow,
+ * see runTimerIfDue(). The replayed edges are left out of the latency
+ * statistics.
+ */
+class EdgeTraceReplay
+{
+  public:
+    EdgeTraceReplay() = delete;
+    EdgeTraceReplay(const EdgeTraceReplay&) = delete;
+    EdgeTraceReplay& operator=(const EdgeTraceReplay&) = delete;
+    EdgeTraceReplay(EdgeTraceReplay&&) = delete;
+    EdgeTraceReplay& operator=(EdgeTraceReplay&&) = delete;
+
+    /**
+     * @brief loads the trace, errors are logged and leave nothing to replay
+     */
+    EdgeTraceReplay(EventPtr& event, SimGpioBackend& backend,
+                    const std::string& path, bool realTime);
+
+    /**
+     * @brief starts the replay from the event loop
+     * @return false if the trace is empty or could not be loaded
+     */
+    bool start();
+
+  private:
+    void scheduleNext();
+
+    static int replayHandler(sd_event_source* es, uint64_t usec,
+                             void* userdata);
+
+    EventPtr& event;
+    SimGpioBackend& backend;
+    bool realTime;
+    std::vector<EdgeTraceRecord> records;
+    size_t next = 0;
+    // replay start time, and how the trace timestamps map to it
+    uint64_t startUsec = 0;
+    uint64_t traceStartUsec = 0;
+    EventSourcePtr timer;
+};
@@ -0,0 +1,112 @@
+#pragma once
+#include "config.h"
+
+#include "common.hpp"
+#include "edge_event.hpp"
+
+#include <nlohmann/json.hpp>
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/server/interface.hpp>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// default time allowed between two presses of a multi press gesture
+constexpr uint64_t defaultClickWindowMs = 400;
+
+enum class GestureType
+{
+    multiPress, // the button is pressed "count" times in a row
+    hold,       // the button is held for "hold_ms"
+    chord       // all the buttons are held together for "hold_ms"
+};
+
+/**
+ * @class GestureEngine
+ *
+ * Recognizes gestures on top of the raw gpio edges, such as a double press,
+ * holding a button for some time or holding several buttons together. The
+ * gestures are read from the "gestures" array of the gpio defs json file and
+ * compiled into per button state machines driven by the edge timestamps and
+ * sd-event timers. A gesture applies to the buttons of its "instance", 0 by
+ * default, on systems with one button per host. A Recognized signal is
+ * emitted for each gesture:
+ *
+ * {
+ *   "name": "power_double_press",
+ *   "type": "multi_press",
+ *   "button": "POWER_BUTTON",
+ *   "count": 2,
+ *   "window_ms": 400
+ * },
+ * {
+ *   "name": "power_reset_hold",
+ *   "type": "chord",
+ *   "buttons": ["POWER_BUTTON", "RESET_BUTTON"],
+ *   "hold_ms": 3000
+ * }
+ */
+class GestureEngine
+{
+  public:
+    GestureEngine() = delete;
+    GestureEngine(const GestureEngine&) = delete;
+    GestureEngine& operator=(const GestureEngine&) = delete;
+    GestureEngine(GestureEngine&&) = delete;
+    GestureEngine& operator=(GestureEngine&&) = delete;
+
+    GestureEngine(sdbusplus::bus_t& bus, EventPtr& event,
+                  const nlohmann::json& gestureDefs);
+
+    /**
+     * @brief feeds a gpio edge into the state machines
+     */
+    void handleEdge(const EdgeEvent& edge);
+
+  private:
+    struct ButtonTrack;
+
+    struct Gesture
+    {
+        GestureEngine* engine;
+        std::string name;
+        GestureType type;
+        unsigned count;
+        uint64_t holdUsec;
+        std::vector<ButtonTrack*> buttons;
+        EventSourcePtr timer;
+    };
+
+    struct ButtonTrack
+    {
+        GestureEngine* engine;
+        bool asserted = false;
+        // a hold or chord fired during the current press, so the press is
+        // not counted as a click
+        bool holdFired = false;
+        unsigned clicks = 0;
+        uint64_t clickWindowUsec = 0;
+        std::vector<Gesture*> multiPress;
+        std::vector<Gesture*> holds;
+        EventSourcePtr clickTimer;
+    };
+
+    ButtonTrack& getTrack(const std::string& button, size_t instance);
+    EventSourcePtr createTimer(sd_event_time_handler_t handler, void* data);
+    void armTimer(sd_event_source* timer, uint64_t usec);
+    void emitGesture(const Gesture& gesture, uint64_t usec);
+
+    static int clickTimerHandler(sd_event_source* es, uint64_t usec,
+                                 void* userdata);
+    static int holdTimerHandler(sd_event_source* es, uint64_t usec,
+                                void* userdata);
+
+    sdbusplus::bus_t& bus;
+    EventPtr& event;
+    std::unique_ptr<sdbusplus::server::interface_t> signalIface;
+    std::vector<std::unique_ptr<Gesture>> gestures;
+    // tracks by button name and instance
+    std::map<std::string, std::map<size_t, ButtonTrack>, std::less<>> tracks;
+};
@@ -18,6 +18,7 @@
 #include <nlohmann/json.hpp>
 #include <sdbusplus/bus.hpp>
 
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -35,10 +36,13 @@ enum class GpioPolarity
     activeHigh
 };
 
-struct GPIOBufferValue
+// a level read from a gpio line, with the time it was seen. The same
+// representation is used by all the gpio backends.
+struct GpioEdge
 {
-    char assert;
-    char deassert;
+    bool high;              // raw level of the line
+    uint64_t timestamp;     // CLOCK_MONOTONIC, in microseconds
+    bool synthetic = false; // injected or replayed, not in the latency stats
 };
 
 // this struct has the gpio config for single gpio
@@ -49,6 +53,7 @@ struct gpioInfo
     std::string name;
     std::string direction;
     GpioPolarity polarity;
+    bool polled = false; // read by the gpio poller, not on interrupts
 };
 
 // this struct represents button interface
@@ -57,6 +62,9 @@ struct buttonConfig
     std::string formFactorName;   // name of the button interface
     std::vector<gpioInfo> gpios;  // holds single or group gpio config
     nlohmann::json extraJsonInfo; // corresponding to button interface
+    std::optional<int64_t> eventPriority; // sd-event priority of the gpios
+    std::string dbusObjectPath;           // empty if not on D-Bus
+    size_t instance = 0; // tells apart the buttons of the same name
 };
 
 /**
@@ -75,11 +83,12 @@ int configGroupGpio(buttonConfig& buttonCfg);
 
 int configGpio(gpioInfo& gpioConfig);
 
+uint32_t getGpioBase();
 uint32_t getGpioNum(const std::string& gpioPin);
 // Set gpio state based on polarity
-void setGpioState(int fd, GpioPolarity polarity, GpioState state);
+void setGpioState(const gpioInfo& gpio, GpioState state);
 // Get gpio state based on polarity
-GpioState getGpioState(int fd, GpioPolarity polarity);
+GpioState getGpioState(const gpioInfo& gpio);
 
 void closeGpio(int fd);
 // global json object which holds gpio_defs.json configs
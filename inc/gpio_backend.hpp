@@ -0,0 +1,213 @@
+#pragma once
+
+#include "gpio.hpp"
+
+#include <gpioplus/chip.hpp>
+#include <gpioplus/event.hpp>
+#include <gpioplus/handle.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+/**
+ * @class GpioBackend
+ *
+ * Access to the gpio lines. Each line is an fd which the event loop polls
+ * for the backend's pollEvents(); reading it returns the pending edge, or
+ * the current level if no edge is pending. The backend is selected once at
+ * startup, before any gpio is configured.
+ */
+class GpioBackend
+{
+  public:
+    virtual ~GpioBackend() = default;
+
+    /**
+     * @brief configures the gpio and stores its fd in gpio.fd
+     * @return int returns 0 on success, negative otherwise
+     */
+    virtual int open(gpioInfo& gpio) = 0;
+
+    /**
+     * @brief epoll events which report a change of a gpio fd
+     */
+    virtual uint32_t pollEvents() const = 0;
+
+    /**
+     * @brief reads the pending edge of a gpio, or its current level
+     * @return int returns 0 on success, negative errno otherwise
+     */
+    virtual int read(int fd, GpioEdge& edge) = 0;
+
+    // a level read by readLevels()
+    struct LevelRead
+    {
+        int fd;
+        bool high;
+        int result; // 0 on success, negative errno otherwise
+    };
+
+    /**
+     * @brief reads the current level of several gpios, in as few syscalls
+     * as the backend allows. Reads them one by one unless overridden.
+     */
+    virtual void readLevels(std::span<LevelRead> reads);
+
+    /**
+     * @brief drives an output gpio
+     * @return int returns 0 on success, negative errno otherwise
+     */
+    virtual int write(int fd, bool high) = 0;
+
+    virtual void close(int fd) = 0;
+
+    /**
+     * @brief true if the lines are simulated and need no gpio chip
+     */
+    virtual bool simulated() const
+    {
+        return false;
+    }
+};
+
+// the /sys/class/gpio interface
+class SysfsGpioBackend : public GpioBackend
+{
+  public:
+    int open(gpioInfo& gpio) override;
+    uint32_t pollEvents() const override;
+    int read(int fd, GpioEdge& edge) override;
+    int write(int fd, bool high) override;
+    void close(int fd) override;
+};
+
+/**
+ * @class ChardevGpioBackend
+ *
+ * The gpio character device of the chip labeled GPIO_BASE_LABEL_NAME,
+ * through gpioplus. The inputs are requested as line events, so edges carry
+ * the kernel timestamp of the interrupt, and the outputs as line handles.
+ * The polled inputs share one multi-line handle, re-requested whenever a
+ * polled line is opened or closed, so readLevels() reads all of them with a
+ * single ioctl. As that handle has a single fd, each polled line gets an
+ * eventfd which is never readable, only to identify it.
+ */
+class ChardevGpioBackend : public GpioBackend
+{
+  public:
+    int open(gpioInfo& gpio) override;
+    uint32_t pollEvents() const override;
+    int read(int fd, GpioEdge& edge) override;
+    void readLevels(std::span<LevelRead> reads) override;
+    int write(int fd, bool high) override;
+    void close(int fd) override;
+
+  private:
+    // a requested line. The event and handle own the fd of their line, the
+    // fd of a polled line is closed by close().
+    struct Line
+    {
+        std::unique_ptr<gpioplus::Event> event;
+        std::unique_ptr<gpioplus::Handle> handle;
+        bool polled = false;
+        uint32_t offset = 0;
+    };
+
+    /**
+     * @brief requests the handle of the polled lines again, for the current
+     * polledOffsets
+     * @return int returns 0 on success, negative errno otherwise
+     */
+    int requestPolled();
+
+    /**
+     * @brief reads the values of all the polled lines into polledValues
+     * @return int returns 0 on success, negative errno otherwise
+     */
+    int readPolled();
+
+    // returns the index of the polled line in polledOffsets and
+    // polledValues
+    size_t polledIndex(const Line& line) const;
+
+    std::unique_ptr<gpioplus::Chip> chip;
+    // lines by fd
+    std::map<int, Line> lines;
+    // the polled lines, in the order of the values of polledHandle
+    std::vector<uint32_t> polledOffsets;
+    std::unique_ptr<gpioplus::Handle> polledHandle;
+    std::vector<uint8_t> polledValues;
+    // line values, kept to not allocate on each read
+    std::vector<uint8_t> values;
+};
+
+/**
+ * @class SimGpioBackend
+ *
+ * In-process simulated gpios, for running the daemon without the hardware.
+ * Each line is an eventfd which becomes readable when an edge is injected,
+ * with the exact timestamp given by the caller. The lines start high, the
+ * released level of the active low buttons.
+ */
+class SimGpioBackend : public GpioBackend
+{
+  public:
+    int open(gpioInfo& gpio) override;
+    uint32_t pollEvents() const override;
+    int read(int fd, GpioEdge& edge) override;
+    int write(int fd, bool high) override;
+    void close(int fd) override;
+
+    bool simulated() const override
+    {
+        return true;
+    }
+
+    /**
+     * @brief queues an edge on the gpio with the given number
+     * @return false if no such gpio is open
+     */
+    bool inject(uint32_t number, const GpioEdge& edge);
+
+    /**
+     * @brief makes every read of the gpio with the given number fail with
+     * the given negative errno, 0 to read it again. A failing line stays
+     * readable, also once it is opened again.
+     */
+    void failReads(uint32_t number, int error);
+
+  private:
+    struct Line
+    {
+        uint32_t number;
+        bool high = true;
+        std::deque<GpioEdge> pending;
+    };
+
+    // lines by fd
+    std::map<int, Line> lines;
+    // errors of the failing gpios by number
+    std::map<uint32_t, int> readErrors;
+};
+
+/**
+ * @brief returns the gpio backend in use, sysfs unless another one was
+ * selected
+ */
+GpioBackend& getGpioBackend();
+
+/**
+ * @brief selects the gpio backend: "sysfs", "chardev" or "sim"
+ * @return false if the name is unknown
+ */
+bool setGpioBackend(const std::string& name);
+
+/**
+ * @brief returns CLOCK_MONOTONIC in microseconds
+ */
+uint64_t getMonotonicUsec();
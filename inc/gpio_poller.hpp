@@ -0,0 +1,92 @@
+#pragma once
+
+#include "common.hpp"
+#include "gpio.hpp"
+#include "gpio_backend.hpp"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+class ButtonIface;
+
+// the polled lines are read every pollFastUsec while they change, and the
+// interval doubles on each idle tick up to pollSlowUsec
+constexpr uint64_t pollFastUsec = 10 * 1000;
+constexpr uint64_t pollSlowUsec = 320 * 1000;
+
+// the cost of the polling is logged this often
+constexpr uint64_t pollReportUsec = 10 * 60 * 1000 * 1000ULL;
+
+/**
+ * @class GpioPoller
+ *
+ * Reads the gpio lines which cannot raise edge interrupts, such as the lines
+ * of some I2C expanders, from a single sd-event timer. All the polled lines
+ * are read on each tick, in one batch through GpioBackend::readLevels(), and
+ * a changed level is fed to its button as an edge, so the polled lines go
+ * through the same decoding and listeners as the others. The timer runs at
+ * the most urgent event priority of the polled lines. The time spent polling
+ * is logged every pollReportUsec.
+ */
+class GpioPoller
+{
+  public:
+    GpioPoller(const GpioPoller&) = delete;
+    GpioPoller& operator=(const GpioPoller&) = delete;
+    GpioPoller(GpioPoller&&) = delete;
+    GpioPoller& operator=(GpioPoller&&) = delete;
+
+    static GpioPoller& instance()
+    {
+        static GpioPoller gpioPollerObj;
+        return gpioPollerObj;
+    }
+
+    /**
+     * @brief starts polling the gpio at the given index of the button,
+     * from the given level, at the given sd-event priority
+     * @return int returns 0 on success, negative errno otherwise
+     */
+    int add(EventPtr& event, ButtonIface* button, size_t index,
+            const gpioInfo& gpio, bool high, int64_t priority);
+
+    /**
+     * @brief stops polling the gpio at the given index of the button
+     */
+    void remove(const ButtonIface* button, size_t index);
+
+  private:
+    GpioPoller() = default;
+
+    struct PolledLine
+    {
+        ButtonIface* button;
+        size_t index;
+        int fd;
+        uint32_t number;
+        bool high;
+        int64_t priority;
+    };
+
+    void poll(uint64_t now);
+    void updatePriority();
+    void schedule(uint64_t now);
+
+    static int pollHandler(sd_event_source* es, uint64_t usec,
+                           void* userdata);
+
+    std::vector<PolledLine> lines;
+    // the reads and the lines which changed or failed on a tick, kept to
+    // not allocate
+    std::vector<GpioBackend::LevelRead> reads;
+    std::vector<std::pair<PolledLine, GpioEdge>> changed;
+    std::vector<PolledLine> failed;
+    EventSourcePtr timer;
+    uint64_t interval = pollFastUsec;
+
+    // cost of the polling since the last report
+    uint64_t ticks = 0;
+    uint64_t busyUsec = 0;
+    uint64_t lastReportUsec = 0;
+};
@@ -5,6 +5,7 @@
 #include "button_interface.hpp"
 #include "common.hpp"
 #include "gpio.hpp"
+#include "state_page.hpp"
 #include "xyz/openbmc_project/Chassis/Buttons/HostSelector/server.hpp"
 #include "xyz/openbmc_project/Chassis/Common/error.hpp"
 
@@ -58,11 +59,28 @@ class HostSelector final :
     {
         return HS_DBUS_OBJECT_NAME;
     }
+
+    static constexpr int64_t getDefaultEventPriority()
+    {
+        return eventPriorityNormal;
+    }
     void handleEvent(sd_event_source* es, int fd, uint32_t revents) override;
     size_t getMappedHSConfig(size_t hsPosition);
     size_t getGpioIndex(int fd);
     void setInitialHostSelectorValue(void);
     void setHostSelectorValue(int fd, GpioState state);
+    void gpioRecovered(size_t index) override;
+
+    using sdbusplus::xyz::openbmc_project::Chassis::Buttons::server::
+        HostSelector::position;
+
+    // every position change, including a Set over D-Bus, ends up here
+    size_t position(size_t value, bool skipSignal) override
+    {
+        StatePage::instance().setSelectorPosition(value);
+        return sdbusplus::xyz::openbmc_project::Chassis::Buttons::server::
+            HostSelector::position(value, skipSignal);
+    }
 
   protected:
     size_t hostSelectorPosition = 0;
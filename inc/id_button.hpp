@@ -61,6 +61,10 @@ class IDButton :
     {
         return ID_DBUS_OBJECT_NAME;
     }
+    static constexpr int64_t getDefaultEventPriority()
+    {
+        return eventPriorityNormal;
+    }
 
     void handleEvent(sd_event_source* es, int fd, uint32_t revents) override;
 };
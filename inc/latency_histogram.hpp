@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+
+/**
+ * @class LatencyHistogram
+ *
+ * Fixed size histogram of latencies in microseconds, with one power of two
+ * bucket per bit. Recording is a couple of instructions and never allocates,
+ * so it can stay enabled in production; percentiles are resolved to the upper
+ * bound of their bucket, i.e. within a factor of two.
+ */
+class LatencyHistogram
+{
+  public:
+    void record(uint64_t usec)
+    {
+        buckets[std::bit_width(usec)]++;
+        total++;
+        maxUsec = std::max(maxUsec, usec);
+    }
+
+    uint64_t count() const
+    {
+        return total;
+    }
+
+    uint64_t max() const
+    {
+        return maxUsec;
+    }
+
+    /**
+     * @brief returns the latency below which the given fraction (0 to 1) of
+     * the recorded latencies fall, 0 if nothing was recorded
+     */
+    uint64_t percentile(double fraction) const
+    {
+        if (total == 0)
+        {
+            return 0;
+        }
+
+        auto rank = static_cast<uint64_t>(fraction * (total - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < buckets.size(); bucket++)
+        {
+            seen += buckets[bucket];
+            if ((seen >= rank) && (bucket < 64))
+            {
+                // bucket n holds [2^(n-1), 2^n)
+                uint64_t bound = (bucket == 0) ? 0 : (1ULL << bucket) - 1;
+                return std::min(bound, maxUsec);
+            }
+        }
+        return maxUsec;
+    }
+
+  private:
+    std::array<uint64_t, 65> buckets{};
+    uint64_t total = 0;
+    uint64_t maxUsec = 0;
+};
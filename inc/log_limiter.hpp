@@ -0,0 +1,179 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+// repeats of an error are logged at most once per this interval
+constexpr std::chrono::seconds logLimitInterval{60};
+
+/**
+ * @class LogLimiter
+ *
+ * Rate limits the error logs of the paths which can fail over and over, such
+ * as a broken gpio line or a missing D-Bus service, so that they cannot flood
+ * the journal. An error is keyed by its source and its message literal. The
+ * source is a stable identity of what failed: the gpio number of a line, as
+ * an fd number is reused once the line is closed, or the address of a
+ * long-lived object such as a button. The first occurrence is logged and the
+ * repeats within logLimitInterval are only counted. Once attached to the
+ * event loop, a timer logs the number of repeats suppressed over each
+ * interval, also after the error stopped. A suppressed occurrence costs a
+ * hash lookup and never allocates.
+ */
+class LogLimiter
+{
+  public:
+    LogLimiter(const LogLimiter&) = delete;
+    LogLimiter& operator=(const LogLimiter&) = delete;
+    LogLimiter(LogLimiter&&) = delete;
+    LogLimiter& operator=(LogLimiter&&) = delete;
+
+    static LogLimiter& instance()
+    {
+        static LogLimiter logLimiterObj;
+        return logLimiterObj;
+    }
+
+    /**
+     * @brief accounts an occurrence of an error
+     *
+     * @param[in] source - what failed, e.g. a gpio number or a button address
+     * @param[in] message - the message literal the caller logs
+     *
+     * @return true if the occurrence is to be logged
+     */
+    bool allow(uintptr_t source, const char* message)
+    {
+        auto now = std::chrono::steady_clock::now();
+        auto& entry = entries[{source, message}];
+        if (entry.logged && (now - entry.lastLog < logLimitInterval))
+        {
+            entry.suppressed++;
+            return false;
+        }
+
+        logSuppressed(message, entry);
+        entry.logged = true;
+        entry.lastLog = now;
+        return true;
+    }
+
+    bool allow(const void* source, const char* message)
+    {
+        return allow(reinterpret_cast<uintptr_t>(source), message);
+    }
+
+    /**
+     * @brief starts the timer which logs the suppressed repeats every
+     * logLimitInterval. Without it, they are only logged before the next
+     * occurrence of the error.
+     */
+    void attach(EventPtr& event)
+    {
+        uint64_t now = 0;
+        sd_event_now(event.get(), CLOCK_MONOTONIC, &now);
+
+        sd_event_source* source = nullptr;
+        int ret = sd_event_add_time(event.get(), &source, CLOCK_MONOTONIC,
+                                    now + intervalUsec(), 0, flushHandler,
+                                    this);
+        if (ret < 0)
+        {
+            lg2::error("Failed to create the log limiter timer: {RET}", "RET",
+                       ret);
+            return;
+        }
+        timer.reset(source);
+    }
+
+  private:
+    LogLimiter() = default;
+
+    struct Key
+    {
+        uintptr_t source;
+        const char* message;
+
+        bool operator==(const Key&) const = default;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            return std::hash<uintptr_t>{}(key.source) ^
+                   (std::hash<const char*>{}(key.message) << 1);
+        }
+    };
+
+    struct Entry
+    {
+        bool logged = false;
+        std::chrono::steady_clock::time_point lastLog;
+        uint64_t suppressed = 0;
+    };
+
+    static constexpr uint64_t intervalUsec()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   logLimitInterval)
+            .count();
+    }
+
+    static void logSuppressed(const char* message, Entry& entry)
+    {
+        if (entry.suppressed > 0)
+        {
+            lg2::warning("Suppressed {COUNT} repeats of: {MESSAGE}", "COUNT",
+                         entry.suppressed, "MESSAGE", message);
+            entry.suppressed = 0;
+        }
+    }
+
+    /**
+     * @brief logs the repeats of the errors whose interval is over, and
+     * forgets the errors which did not repeat
+     */
+    void flush()
+    {
+        auto now = std::chrono::steady_clock::now();
+        for (auto it = entries.begin(); it != entries.end();)
+        {
+            auto& entry = it->second;
+            if (now - entry.lastLog < logLimitInterval)
+            {
+                ++it;
+            }
+            else if (entry.suppressed == 0)
+            {
+                it = entries.erase(it);
+            }
+            else
+            {
+                // the summary stands for a logged occurrence, the next
+                // repeats are counted for another interval
+                logSuppressed(it->first.message, entry);
+                entry.lastLog = now;
+                ++it;
+            }
+        }
+    }
+
+    static int flushHandler(sd_event_source* es, uint64_t usec,
+                            void* userdata)
+    {
+        static_cast<LogLimiter*>(userdata)->flush();
+        sd_event_source_set_time(es, usec + intervalUsec());
+        sd_event_source_set_enabled(es, SD_EVENT_ONESHOT);
+        return 0;
+    }
+
+    std::unordered_map<Key, Entry, KeyHash> entries;
+    EventSourcePtr timer;
+};
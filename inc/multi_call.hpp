@@ -0,0 +1,8 @@
+#pragma once
+
+/*
+ * Entry points of the daemons when they are built into a single multi-call
+ * binary, see the multi-call meson option.
+ */
+int buttonsMain(int argc, char** argv);
+int buttonHandlerMain(int argc, char** argv);
@@ -64,10 +64,16 @@ class PowerButton :
     {
         return POWER_DBUS_OBJECT_NAME;
     }
-    void updatePressedTime();
-    auto getPressTime() const;
+    static constexpr int64_t getDefaultEventPriority()
+    {
+        return eventPriorityHigh;
+    }
+    void updatePressedTime(uint64_t usec);
+    uint64_t getPressTime() const;
     void handleEvent(sd_event_source* es, int fd, uint32_t revents) override;
+    void longPressed() override;
 
   protected:
-    decltype(std::chrono::steady_clock::now()) pressedTime;
+    // timestamp of the press edge, CLOCK_MONOTONIC in microseconds
+    uint64_t pressedTime = 0;
 };
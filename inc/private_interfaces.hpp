@@ -0,0 +1,31 @@
+#pragma once
+
+/**
+ * D-Bus interfaces of the buttons daemon which are not defined in
+ * phosphor-dbus-interfaces, and are served through hand-written sd-bus
+ * vtables instead of generated bindings.
+ *
+ * They expose the diagnostics of the daemon (statistics, edge journal, edge
+ * injection) and the experimental gesture signal. Their shape follows the
+ * internals of this daemon and is expected to change with them, which is
+ * why they are not proposed to phosphor-dbus-interfaces as they are. To
+ * keep them from being taken for stable OpenBMC API, they live under the
+ * Private namespace of the buttons service rather than next to the
+ * interfaces phosphor-dbus-interfaces defines, and carry no compatibility
+ * promise between releases. An interface other services are meant to rely
+ * on is to be added to phosphor-dbus-interfaces and served through its
+ * bindings.
+ */
+namespace buttons_private
+{
+
+constexpr auto statisticsIface =
+    "xyz.openbmc_project.Chassis.Buttons.Private.Statistics";
+constexpr auto journalIface =
+    "xyz.openbmc_project.Chassis.Buttons.Private.Journal";
+constexpr auto gestureIface =
+    "xyz.openbmc_project.Chassis.Buttons.Private.Gesture";
+constexpr auto injectorIface =
+    "xyz.openbmc_project.Chassis.Buttons.Private.Injector";
+
+} // namespace buttons_private
@@ -0,0 +1,51 @@
+#pragma once
+#include "config.h"
+
+/*
+ * Static USDT tracepoints, built in with the usdt meson option. A probe is
+ * a single nop until a tracer attaches to it, for example:
+ *
+ * bpftrace -e 'usdt:/usr/bin/buttons:phosphor_buttons:handle_event
+ *     { @start[arg1] = nsecs; }'
+ *
+ * The probe names and arguments are listed in the README. The "_done" probe
+ * of a pair fires on every return and exception path of the function, see
+ * ProbeExit, so that a tracer can always match it with its entry probe.
+ */
+#if USDT_ENABLED
+#include <sys/sdt.h>
+
+#define BUTTONS_PROBE(...) STAP_PROBEV(phosphor_buttons, __VA_ARGS__)
+#else
+#define BUTTONS_PROBE(...)                                                     \
+    do                                                                         \
+    {                                                                          \
+    } while (0)
+#endif
+
+#include <utility>
+
+/**
+ * @class ProbeExit
+ *
+ * Runs the given callable, which fires an exit probe, when leaving the
+ * scope it is declared in.
+ */
+template <typename F>
+class ProbeExit
+{
+  public:
+    explicit ProbeExit(F func) : func(std::move(func)) {}
+    ~ProbeExit()
+    {
+        func();
+    }
+
+    ProbeExit(const ProbeExit&) = delete;
+    ProbeExit& operator=(const ProbeExit&) = delete;
+    ProbeExit(ProbeExit&&) = delete;
+    ProbeExit& operator=(ProbeExit&&) = delete;
+
+  private:
+    F func;
+};
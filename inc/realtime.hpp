@@ -0,0 +1,108 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <sys/resource.h>
+
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+
+// Stack and heap reserved (and pre-faulted) before switching to the
+// real-time scheduler, so the event loop never takes a page fault.
+constexpr size_t rtStackPrefaultSize = 256 * 1024;
+constexpr size_t rtHeapPrefaultSize = 1024 * 1024;
+
+// CPU time the event loop may use at the real-time priority over each
+// budget interval, beyond it the loop is demoted until an interval stays
+// within the budget. Handling a press takes well under a millisecond.
+constexpr uint64_t rtBudgetIntervalUsec = 250 * 1000;
+constexpr uint64_t rtBudgetUsec = 25 * 1000;
+
+// CPU time the loop may run at the real-time priority without blocking
+// (RLIMIT_RTTIME), it is demoted from SIGXCPU beyond it
+constexpr uint64_t rtBurstLimitUsec = 20 * 1000;
+// the kernel kills the process at the hard RLIMIT_RTTIME, the soft limit is
+// left unset when the hard one is not at least this long
+constexpr uint64_t rtBurstHardLimitUsec = 1000 * 1000;
+
+// the budget timer is dispatched ahead of all the gpio sources, an edge
+// storm must not keep it from running
+constexpr int64_t rtBudgetPriority = eventPriorityHigh - 10;
+
+/**
+ * @class RealtimeMode
+ *
+ * Runs the event loop of the buttons daemon under SCHED_FIFO, within a CPU
+ * budget. The gpio edges, the button signals and the D-Bus traffic are all
+ * dispatched by the one loop, so the budget is what keeps anything but the
+ * edge path from taking the CPU at the real-time priority: an edge storm, a
+ * D-Bus client flooding the daemon or a bug spinning in a handler gets the
+ * loop demoted to SCHED_OTHER within rtBurstLimitUsec (RLIMIT_RTTIME and
+ * SIGXCPU) or one rtBudgetIntervalUsec (a CPU time check on a timer). It is
+ * promoted back once an interval stays within rtBudgetUsec.
+ */
+class RealtimeMode
+{
+  public:
+    RealtimeMode(const RealtimeMode&) = delete;
+    RealtimeMode& operator=(const RealtimeMode&) = delete;
+    RealtimeMode(RealtimeMode&&) = delete;
+    RealtimeMode& operator=(RealtimeMode&&) = delete;
+
+    static RealtimeMode& instance()
+    {
+        static RealtimeMode realtimeModeObj;
+        return realtimeModeObj;
+    }
+
+    /**
+     * @brief locks the process memory, pre-faults the stack and the heap
+     * arena and moves the calling thread to SCHED_FIFO with the given
+     * priority, under the CPU budget checked on the event loop. Intended to
+     * be called after the (slow) gpio and D-Bus setup is done, right before
+     * entering the event loop.
+     * @return int returns 0 on success, negative errno otherwise
+     */
+    int enable(EventPtr& event, int priority);
+
+    /**
+     * @brief true while the loop runs at the real-time priority
+     */
+    bool promoted() const
+    {
+        return priority > 0 && !demoted;
+    }
+
+    // number of times the loop went over its budget
+    size_t getDemotions() const
+    {
+        return demotions;
+    }
+
+  private:
+    RealtimeMode() = default;
+
+    // checks the CPU time used over the last interval
+    void checkBudget(uint64_t now);
+
+    int setScheduler(int policy, int priority);
+
+    // undoes what enable() did before the scheduler could not be set
+    void rollback();
+
+    static int budgetHandler(sd_event_source* es, uint64_t usec,
+                             void* userdata);
+    static void burstHandler(int signal);
+
+    int priority = 0;
+    // set from SIGXCPU, the loop is then already demoted
+    static volatile sig_atomic_t burstDemoted;
+    bool demoted = false;
+    size_t demotions = 0;
+    uint64_t lastCpuUsec = 0;
+    EventSourcePtr timer;
+    // the limit and SIGXCPU action found by enable()
+    rlimit oldLimit{};
+    struct sigaction oldAction{};
+};
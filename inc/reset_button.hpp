@@ -63,5 +63,10 @@ class ResetButton :
         return RESET_DBUS_OBJECT_NAME;
     }
 
+    static constexpr int64_t getDefaultEventPriority()
+    {
+        return eventPriorityHigh;
+    }
+
     void handleEvent(sd_event_source* es, int fd, uint32_t revents) override;
 };
@@ -65,7 +65,12 @@ class SerialUartMux final : public ButtonIface
     }
     static const char* getDbusObjectPath()
     {
-        return "NO_DBUS_OBJECT";
+        // no D-Bus object
+        return nullptr;
+    }
+    static constexpr int64_t getDefaultEventPriority()
+    {
+        return eventPriorityLow;
     }
 
     void hostSelectorPositionChanged(sdbusplus::message_t& msg);
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "common.hpp"
+#include "gpio_backend.hpp"
+
+#include <cstdint>
+#include <string>
+
+// an edge sent to the sim control socket, a datagram carries one or more of
+// them
+struct SimEdgeRecord
+{
+    uint32_t number;    // gpio number
+    uint32_t high;      // 1 for a rising edge, 0 for a falling edge
+    uint64_t timestamp; // CLOCK_MONOTONIC in microseconds, 0 for now
+};
+
+// edges accepted in a single datagram
+constexpr size_t simControlMaxBatch = 256;
+
+// oldest edge timestamp accepted, relative to the time the datagram is read
+constexpr uint64_t simControlMaxAgeUsec = 60 * 1000 * 1000;
+
+// the socket is read ahead of all the gpio sources, so the edges of a
+// datagram are all queued on their lines before any of them is handled, as
+// if they had arrived at once
+constexpr int64_t simControlPriority = eventPriorityHigh - 1;
+
+/**
+ * @class SimControlSocket
+ *
+ * Drives the simulated gpio lines from another process, such as a test or a
+ * benchmark, through the Unix datagram socket given with --sim-socket. The
+ * SimEdgeRecords of a datagram are queued on the lines of the sim backend,
+ * so they go through the gpio event sources, their priorities and the
+ * button handlers like the edges of real lines. A timestamp must not be in
+ * the future nor older than simControlMaxAgeUsec, or the whole datagram is
+ * dropped. The edges are left out of the latency statistics.
+ */
+class SimControlSocket
+{
+  public:
+    SimControlSocket() = delete;
+    SimControlSocket(const SimControlSocket&) = delete;
+    SimControlSocket& operator=(const SimControlSocket&) = delete;
+    SimControlSocket(SimControlSocket&&) = delete;
+    SimControlSocket& operator=(SimControlSocket&&) = delete;
+
+    /**
+     * @brief binds the socket, errors are logged and leave it closed
+     */
+    SimControlSocket(EventPtr& event, SimGpioBackend& backend,
+                     const std::string& path);
+    ~SimControlSocket();
+
+    bool enabled() const
+    {
+        return fd >= 0;
+    }
+
+  private:
+    void readEdges();
+
+    static int readHandler(sd_event_source* es, int fd, uint32_t revents,
+                           void* userdata);
+
+    SimGpioBackend& backend;
+    std::string path;
+    int fd = -1;
+    EventSourcePtr source;
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <time.h>
+#include <unistd.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+/**
+ * @brief returns the time since the process was exec'ed, in milliseconds,
+ * so it includes the dynamic linking and relocations. The kernel keeps the
+ * start time in clock ticks, which limits the resolution to 10ms on most
+ * systems. 0 if /proc/self/stat cannot be read.
+ */
+inline uint64_t getProcessAgeMs()
+{
+    std::ifstream statFile{"/proc/self/stat"};
+    std::string stat;
+    std::getline(statFile, stat);
+
+    // the fields after the command name, which may contain spaces
+    auto end = stat.rfind(')');
+    if (end == std::string::npos)
+    {
+        return 0;
+    }
+    std::istringstream fields{stat.substr(end + 1)};
+
+    // starttime is the 22nd field, the 20th after the command name
+    std::string field;
+    for (int i = 0; i < 20; i++)
+    {
+        fields >> field;
+    }
+    uint64_t startTicks = 0;
+    try
+    {
+        startTicks = std::stoull(field);
+    }
+    catch (const std::exception&)
+    {
+        return 0;
+    }
+
+    timespec now{};
+    clock_gettime(CLOCK_BOOTTIME, &now);
+    uint64_t nowMs = (static_cast<uint64_t>(now.tv_sec) * 1000) +
+                     (now.tv_nsec / 1000000);
+    uint64_t startMs = startTicks * 1000 / sysconf(_SC_CLK_TCK);
+    return (nowMs > startMs) ? (nowMs - startMs) : 0;
+}
+
+/**
+ * @brief returns the given field of /proc/self/smaps_rollup in kB, 0 if it
+ * cannot be read
+ */
+inline uint64_t getMemoryRollupKb(const std::string& name)
+{
+    std::ifstream rollup{"/proc/self/smaps_rollup"};
+    std::string line;
+    while (std::getline(rollup, line))
+    {
+        if (line.starts_with(name + ":"))
+        {
+            std::istringstream value{line.substr(name.size() + 1)};
+            uint64_t kb = 0;
+            value >> kb;
+            return kb;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief logs the startup time and memory use of a daemon, to be called
+ * once its setup is done, right before it enters the event loop. The PSS
+ * splits the pages shared with other processes, such as the code of a
+ * multi-call binary run as both daemons, so the PSS of the two daemons adds
+ * up to their combined memory use while their RSS does not.
+ */
+inline void logStartup(const char* name)
+{
+    lg2::info("{NAME} ready {STARTUP_MS}ms after exec, RSS {RSS_KB}kB, "
+              "PSS {PSS_KB}kB",
+              "NAME", name, "STARTUP_MS", getProcessAgeMs(), "RSS_KB",
+              getMemoryRollupKb("Rss"), "PSS_KB", getMemoryRollupKb("Pss"));
+}
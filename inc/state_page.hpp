@@ -0,0 +1,140 @@
+#pragma once
+
+#include "edge_event.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+/*
+ * Layout of the state page published in STATE_PAGE_FILE. Local readers map
+ * the file read-only and copy it out with readStatePage(), which retries
+ * while the sequence counter shows an update in progress. The page is
+ * rewritten in place, a reader only needs to map it again when the daemon
+ * restarts and recreates the file.
+ */
+constexpr uint32_t statePageMagic = 0x4e545442; // "BTTN"
+constexpr uint32_t statePageVersion = 2;
+constexpr size_t statePageMaxButtons = 16;
+constexpr size_t statePageNameSize = 32;
+constexpr int64_t statePagePositionUnknown = -1;
+
+// one slot per button instance, keyed by name and instance
+struct StatePageButton
+{
+    char name[statePageNameSize]; // form factor name, NUL terminated
+    uint32_t instance;            // instance index, 2 for Power2
+    uint32_t level;               // bit n is set while gpio n is asserted
+    uint32_t pressCount;          // assert edges since the daemon started
+    uint32_t reserved;
+    uint64_t lastEdgeUsec;        // CLOCK_MONOTONIC, 0 before the first edge
+};
+
+struct StatePageData
+{
+    int64_t selectorPosition; // host selector position, -1 if unknown
+    uint32_t buttonCount;
+    uint32_t reserved;
+    StatePageButton buttons[statePageMaxButtons];
+};
+
+struct StatePageLayout
+{
+    uint32_t magic;
+    uint32_t version;
+    // odd while the page is being written
+    std::atomic<uint32_t> sequence;
+    uint32_t reserved;
+    StatePageData data;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+/**
+ * @brief copies a consistent snapshot of the state page
+ */
+inline StatePageData readStatePage(const StatePageLayout& page)
+{
+    StatePageData data;
+    while (true)
+    {
+        uint32_t begin = page.sequence.load(std::memory_order_acquire);
+        if ((begin & 1) == 0)
+        {
+            std::memcpy(&data, &page.data, sizeof(data));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (page.sequence.load(std::memory_order_relaxed) == begin)
+            {
+                return data;
+            }
+        }
+    }
+}
+
+/**
+ * @class StatePage
+ *
+ * Publishes the level, last edge time and press count of each button and
+ * the host selector position in a small shared memory page, so that local
+ * daemons can read the button state without any IPC. D-Bus stays the
+ * control interface. The page is written by the event loop only.
+ */
+class StatePage
+{
+  public:
+    StatePage(const StatePage&) = delete;
+    StatePage& operator=(const StatePage&) = delete;
+    StatePage(StatePage&&) = delete;
+    StatePage& operator=(StatePage&&) = delete;
+
+    static StatePage& instance()
+    {
+        static StatePage statePageObj;
+        return statePageObj;
+    }
+
+    /**
+     * @brief creates and maps the state page file
+     *
+     * @return false if the page could not be created, the updates are
+     *         then ignored
+     */
+    bool open(const char* path);
+
+    /**
+     * @brief records a gpio edge of a button
+     */
+    void update(const EdgeEvent& edge);
+
+    /**
+     * @brief records the level a gpio of a button starts from, without
+     * counting it as an edge
+     */
+    void setLevel(std::string_view name, size_t instance, size_t line,
+                  GpioState state);
+
+    /**
+     * @brief records the host selector position
+     */
+    void setSelectorPosition(size_t position);
+
+  private:
+    StatePage() = default;
+    ~StatePage();
+
+    StatePageButton* getButton(std::string_view name, size_t instance);
+
+    void beginWrite()
+    {
+        page->sequence.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void endWrite()
+    {
+        page->sequence.fetch_add(1, std::memory_order_release);
+    }
+
+    StatePageLayout* page = nullptr;
+};
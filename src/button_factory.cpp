@@ -0,0 +1,104 @@
+#include "config.h"
+
+#include "button_factory.hpp"
+
+#if POWER_BUTTON_ENABLED
+#include "power_button.hpp"
+#endif
+#if RESET_BUTTON_ENABLED
+#include "reset_button.hpp"
+#endif
+#if ID_BUTTON_ENABLED
+#include "id_button.hpp"
+#endif
+#if HOST_SELECTOR_ENABLED
+#include "hostSelector_switch.hpp"
+#endif
+#if DEBUG_HOST_SELECTOR_ENABLED
+#include "debugHostSelector_button.hpp"
+#endif
+#if SERIAL_UART_MUX_ENABLED
+#include "serial_uart_mux.hpp"
+#endif
+
+#include <type_traits>
+
+// only the button types built in are defined
+class PowerButton;
+class ResetButton;
+class IDButton;
+class HostSelector;
+class DebugHostSelector;
+class SerialUartMux;
+
+namespace
+{
+
+template <typename T>
+bool createIfNamed(const std::string& name, sdbusplus::bus_t& bus,
+                   EventPtr& event, buttonConfig& buttonCfg,
+                   std::unique_ptr<ButtonIface>& button)
+{
+    if (name != T::getFormFactorName())
+    {
+        return false;
+    }
+    button = ButtonFactory::create<T>(bus, event, buttonCfg);
+    return true;
+}
+
+template <typename... Types>
+struct ButtonTypeList
+{
+    static std::unique_ptr<ButtonIface>
+        create(const std::string& name, sdbusplus::bus_t& bus,
+               EventPtr& event, buttonConfig& buttonCfg)
+    {
+        std::unique_ptr<ButtonIface> button;
+        // stops at the first type with a matching name
+        static_cast<void>(
+            (createIfNamed<Types>(name, bus, event, buttonCfg, button) || ...));
+        return button;
+    }
+};
+
+template <bool enabled, typename T>
+using OptionalButtonType =
+    std::conditional_t<enabled, ButtonTypeList<T>, ButtonTypeList<>>;
+
+template <typename... Lists>
+struct JoinButtonTypes;
+
+template <typename... Types>
+struct JoinButtonTypes<ButtonTypeList<Types...>>
+{
+    using type = ButtonTypeList<Types...>;
+};
+
+template <typename... First, typename... Second, typename... Rest>
+struct JoinButtonTypes<ButtonTypeList<First...>, ButtonTypeList<Second...>,
+                       Rest...>
+{
+    using type =
+        typename JoinButtonTypes<ButtonTypeList<First..., Second...>,
+                                 Rest...>::type;
+};
+
+// the button types selected with the button-types meson option
+using BuiltinButtonTypes = JoinButtonTypes<
+    OptionalButtonType<POWER_BUTTON_ENABLED, PowerButton>,
+    OptionalButtonType<RESET_BUTTON_ENABLED, ResetButton>,
+    OptionalButtonType<ID_BUTTON_ENABLED, IDButton>,
+    OptionalButtonType<HOST_SELECTOR_ENABLED, HostSelector>,
+    OptionalButtonType<DEBUG_HOST_SELECTOR_ENABLED, DebugHostSelector>,
+    OptionalButtonType<SERIAL_UART_MUX_ENABLED, SerialUartMux>>::type;
+
+} // namespace
+
+std::unique_ptr<ButtonIface>
+    ButtonFactory::createInstance(const std::string& name,
+                                  sdbusplus::bus_t& bus, EventPtr& event,
+                                  buttonConfig& buttonCfg)
+{
+    return BuiltinButtonTypes::create(name, bus, event, buttonCfg);
+}
@@ -2,9 +2,18 @@
 
 #include "button_handler.hpp"
 
+#include "log_limiter.hpp"
+#include "probes.hpp"
+
 #include <phosphor-logging/lg2.hpp>
 #include <xyz/openbmc_project/State/Chassis/server.hpp>
 #include <xyz/openbmc_project/State/Host/server.hpp>
+
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <optional>
+#include <utility>
 namespace phosphor
 {
 namespace button
@@ -30,22 +39,90 @@ constexpr auto mapperIface = "xyz.openbmc_project.ObjectMapper";
 
 constexpr auto mapperObjPath = "/xyz/openbmc_project/object_mapper";
 constexpr auto mapperService = "xyz.openbmc_project.ObjectMapper";
+constexpr auto buttonsRootPath = "/xyz/openbmc_project/Chassis/Buttons";
+constexpr auto stateRootPath = "/xyz/openbmc_project/state";
 constexpr auto BMC_POSITION = 0;
+constexpr auto policyFile = "/etc/default/obmc/button-handler/policy.json";
+
+/**
+ * @brief returns the number at the end of an object path, such as the host
+ * number of /xyz/openbmc_project/state/host2, or 0 if there is none. Empty
+ * if the number does not fit, the path is then ignored.
+ */
+static std::optional<size_t> getPathInstance(const std::string& path)
+{
+    auto digits = path.find_last_not_of("0123456789") + 1;
+    size_t instance = 0;
+    if (digits < path.size())
+    {
+        auto [end, ec] = std::from_chars(path.data() + digits,
+                                         path.data() + path.size(), instance);
+        if (ec != std::errc{})
+        {
+            return std::nullopt;
+        }
+    }
+    return instance;
+}
 
-Handler::Handler(sdbusplus::bus_t& bus) : bus(bus)
+Handler::Handler(sdbusplus::bus_t& bus) : Handler(bus, policyFile) {}
+
+Handler::Handler(sdbusplus::bus_t& bus, const std::string& policyPath) :
+    bus(bus)
 {
+    std::ifstream policyStream{policyPath};
+    if (policyStream.is_open())
+    {
+        try
+        {
+            policy.load(nlohmann::json::parse(policyStream, nullptr, true));
+            lg2::info("Loaded button policy from {FILE}", "FILE", policyPath);
+        }
+        catch (const std::exception& e)
+        {
+            lg2::error("Failed to load button policy {FILE}: {ERROR}", "FILE",
+                       policyPath, "ERROR", e);
+        }
+    }
+
+    // keeps the cached host selector position up to date
+    hostSelectorChanged = std::make_unique<sdbusplus::bus::match_t>(
+        bus,
+        sdbusRule::propertiesChanged(HS_DBUS_OBJECT_NAME, hostSelectorIface),
+        std::bind(std::mem_fn(&Handler::hostSelectorPropertiesChanged), this,
+                  std::placeholders::_1));
+
+    // drops the cached properties of a service restarting or going away
+    serviceOwnerChanged = std::make_unique<sdbusplus::bus::match_t>(
+        bus, sdbusRule::nameOwnerChanged(),
+        std::bind(std::mem_fn(&Handler::nameOwnerChanged), this,
+                  std::placeholders::_1));
+
+    // keeps the cached host states up to date
+    hostStateChanged = std::make_unique<sdbusplus::bus::match_t>(
+        bus, sdbusRule::propertiesChangedNamespace(stateRootPath, hostIface),
+        std::bind(std::mem_fn(&Handler::hostPropertiesChanged), this,
+                  std::placeholders::_1));
+
     try
     {
-        if (!getService(POWER_DBUS_OBJECT_NAME, powerButtonIface).empty())
+        if (addButtonInstances(powerButtonIface))
         {
             lg2::info("Starting power button handler");
             powerButtonReleased = std::make_unique<sdbusplus::bus::match_t>(
                 bus,
                 sdbusRule::type::signal() + sdbusRule::member("Released") +
-                    sdbusRule::path(POWER_DBUS_OBJECT_NAME) +
+                    sdbusRule::path_namespace(buttonsRootPath) +
                     sdbusRule::interface(powerButtonIface),
                 std::bind(std::mem_fn(&Handler::powerReleased), this,
                           std::placeholders::_1));
+            powerButtonLongPressed = std::make_unique<sdbusplus::bus::match_t>(
+                bus,
+                sdbusRule::type::signal() + sdbusRule::member("PressedLong") +
+                    sdbusRule::path_namespace(buttonsRootPath) +
+                    sdbusRule::interface(powerButtonIface),
+                std::bind(std::mem_fn(&Handler::powerLongPressed), this,
+                          std::placeholders::_1));
         }
     }
     catch (const sdbusplus::exception_t& e)
@@ -55,13 +132,13 @@ Handler::Handler(sdbusplus::bus_t& bus) : bus(bus)
 
     try
     {
-        if (!getService(ID_DBUS_OBJECT_NAME, idButtonIface).empty())
+        if (addButtonInstances(idButtonIface))
         {
             lg2::info("Registering ID button handler");
             idButtonReleased = std::make_unique<sdbusplus::bus::match_t>(
                 bus,
                 sdbusRule::type::signal() + sdbusRule::member("Released") +
-                    sdbusRule::path(ID_DBUS_OBJECT_NAME) +
+                    sdbusRule::path_namespace(buttonsRootPath) +
                     sdbusRule::interface(idButtonIface),
                 std::bind(std::mem_fn(&Handler::idReleased), this,
                           std::placeholders::_1));
@@ -74,13 +151,13 @@ Handler::Handler(sdbusplus::bus_t& bus) : bus(bus)
 
     try
     {
-        if (!getService(RESET_DBUS_OBJECT_NAME, resetButtonIface).empty())
+        if (addButtonInstances(resetButtonIface))
         {
             lg2::info("Registering reset button handler");
             resetButtonReleased = std::make_unique<sdbusplus::bus::match_t>(
                 bus,
                 sdbusRule::type::signal() + sdbusRule::member("Released") +
-                    sdbusRule::path(RESET_DBUS_OBJECT_NAME) +
+                    sdbusRule::path_namespace(buttonsRootPath) +
                     sdbusRule::interface(resetButtonIface),
                 std::bind(std::mem_fn(&Handler::resetReleased), this,
                           std::placeholders::_1));
@@ -103,6 +180,16 @@ Handler::Handler(sdbusplus::bus_t& bus) : bus(bus)
                     sdbusRule::interface(debugHostSelectorIface),
                 std::bind(std::mem_fn(&Handler::debugHostSelectorReleased),
                           this, std::placeholders::_1));
+            debugHSButtonLongPressed =
+                std::make_unique<sdbusplus::bus::match_t>(
+                    bus,
+                    sdbusRule::type::signal() +
+                        sdbusRule::member("PressedLong") +
+                        sdbusRule::path(DBG_HS_DBUS_OBJECT_NAME) +
+                        sdbusRule::interface(debugHostSelectorIface),
+                    std::bind(
+                        std::mem_fn(&Handler::debugHostSelectorLongPressed),
+                        this, std::placeholders::_1));
         }
     }
     catch (const sdbusplus::exception_t& e)
@@ -110,11 +197,176 @@ Handler::Handler(sdbusplus::bus_t& bus) : bus(bus)
         // The button wasn't implemented
     }
 }
+bool Handler::addButtonInstances(const std::string& interface)
+{
+    auto method = bus.new_method_call(mapperService, mapperObjPath, mapperIface,
+                                      "GetSubTreePaths");
+    method.append(buttonsRootPath, 0, std::vector{interface});
+
+    std::vector<std::string> paths;
+    try
+    {
+        auto result = call(method);
+        result.read(paths);
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        return false;
+    }
+
+    for (const auto& path : paths)
+    {
+        auto* instance = getButtonInstance(path);
+        if (instance == nullptr)
+        {
+            lg2::error("Ignoring button {PATH}, its instance number is out of "
+                       "range",
+                       "PATH", path);
+            continue;
+        }
+        lg2::info("Found button {PATH} for host {HOST}", "PATH", path, "HOST",
+                  instance->host);
+    }
+    return !paths.empty();
+}
+
+Handler::ButtonInstance* Handler::getButtonInstance(const std::string& path)
+{
+    auto it = buttonInstances.find(path);
+    if (it != buttonInstances.end())
+    {
+        return &it->second;
+    }
+
+    // the instance number at the end of the path is the host number,
+    // instance 0 follows the host selector position
+    auto host = getPathInstance(path);
+    if (!host)
+    {
+        return nullptr;
+    }
+    return &buttonInstances.emplace(path, ButtonInstance{*host})
+                .first->second;
+}
+
 bool Handler::isMultiHost()
 {
     // return true in case host selector object is available
-    return (!getService(HS_DBUS_OBJECT_NAME, hostSelectorIface).empty());
+    return !getHostSelectorService().empty();
 }
+
+const std::string& Handler::getHostSelectorService()
+{
+    if (hostSelector.service.empty())
+    {
+        hostSelector.service = getService(HS_DBUS_OBJECT_NAME,
+                                          hostSelectorIface);
+    }
+    return hostSelector.service;
+}
+
+void Handler::readHostSelector()
+{
+    if (hostSelector.position && hostSelector.maxPosition)
+    {
+        return;
+    }
+
+    auto HSService = getHostSelectorService();
+    if (HSService.empty())
+    {
+        lg2::info("Host selector dbus object not available");
+        throw std::invalid_argument("Host selector dbus object not available");
+    }
+
+    auto method = bus.new_method_call(HSService.c_str(), HS_DBUS_OBJECT_NAME,
+                                      propertyIface, "GetAll");
+    method.append(hostSelectorIface);
+    auto result = call(method);
+    std::unordered_map<std::string, std::variant<size_t>> properties;
+    result.read(properties);
+
+    hostSelector.maxPosition = std::get<size_t>(properties.at("MaxPosition"));
+    hostSelector.position = std::get<size_t>(properties.at("Position"));
+    hostSelector.pendingSets.clear();
+}
+
+void Handler::hostSelectorPropertiesChanged(sdbusplus::message_t& msg)
+{
+    std::string interface;
+    std::unordered_map<std::string, std::variant<size_t>> properties;
+    try
+    {
+        msg.read(interface, properties);
+    }
+    catch (const std::exception& e)
+    {
+        return;
+    }
+
+    auto maxPosition = properties.find("MaxPosition");
+    if (maxPosition != properties.end())
+    {
+        hostSelector.maxPosition = std::get<size_t>(maxPosition->second);
+    }
+
+    auto position = properties.find("Position");
+    if (position == properties.end())
+    {
+        return;
+    }
+
+    // the signal of a Set sent by the handler, the position is already
+    // known and may even be ahead after rapid presses
+    auto value = std::get<size_t>(position->second);
+    auto& pendingSets = hostSelector.pendingSets;
+    if (!pendingSets.empty() && (pendingSets.front() == value))
+    {
+        pendingSets.pop_front();
+        return;
+    }
+
+    // changed by someone else
+    pendingSets.clear();
+    hostSelector.position = value;
+}
+
+void Handler::nameOwnerChanged(sdbusplus::message_t& msg)
+{
+    std::string name;
+    std::string oldOwner;
+    std::string newOwner;
+    try
+    {
+        msg.read(name, oldOwner, newOwner);
+    }
+    catch (const std::exception& e)
+    {
+        return;
+    }
+
+    // a name given up, or taken over by a restarted service
+    if (oldOwner.empty())
+    {
+        return;
+    }
+
+    if (name == hostSelector.service)
+    {
+        lg2::info("Host selector service {SERVICE} changed owner, dropping "
+                  "the cached position",
+                  "SERVICE", name);
+        hostSelector.service.clear();
+        hostSelector.position.reset();
+        hostSelector.maxPosition.reset();
+        hostSelector.pendingSets.clear();
+    }
+
+    std::erase_if(hostTransitions, [&name](const auto& entry) {
+        return entry.second.service == name;
+    });
+}
+
 std::string Handler::getService(const std::string& path,
                                 const std::string& interface) const
 {
@@ -123,7 +375,7 @@ std::string Handler::getService(const std::string& path,
     method.append(path, std::vector{interface});
     try
     {
-        auto result = bus.call(method);
+        auto result = call(method);
         std::map<std::string, std::vector<std::string>> objectData;
         result.read(objectData);
         return objectData.begin()->first;
@@ -135,197 +387,613 @@ std::string Handler::getService(const std::string& path,
 }
 size_t Handler::getHostSelectorValue()
 {
-    auto HSService = getService(HS_DBUS_OBJECT_NAME, hostSelectorIface);
+    try
+    {
+        readHostSelector();
+        return *hostSelector.position;
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        constexpr auto readError =
+            "Error reading host selector position: {ERROR}";
+        if (LogLimiter::instance().allow(this, readError))
+        {
+            lg2::error(readError, "ERROR", e);
+        }
+        throw;
+    }
+}
+bool Handler::poweredOn(size_t hostNumber)
+{
+    auto& transition = getHostTransition(hostNumber);
+    if (!transition.current)
+    {
+        auto hostObjectName = HOST_STATE_OBJECT_NAME +
+                              std::to_string(hostNumber);
+        auto service = getService(hostObjectName.c_str(), hostIface);
+        auto method = bus.new_method_call(service.c_str(),
+                                          hostObjectName.c_str(),
+                                          propertyIface, "Get");
+        method.append(hostIface, "CurrentHostState");
+        auto result = call(method);
 
-    if (HSService.empty())
+        std::variant<std::string> state;
+        result.read(state);
+        transition.current =
+            Host::convertHostStateFromString(std::get<std::string>(state));
+        transition.service = service;
+    }
+
+    return Host::HostState::Off != *transition.current;
+}
+
+Handler::HostTransition& Handler::getHostTransition(size_t hostNumber)
+{
+    return hostTransitions[hostNumber];
+}
+
+uint64_t Handler::getMonotonicUsec()
+{
+    uint64_t now = 0;
+    sd_event_now(bus.get_event(), CLOCK_MONOTONIC, &now);
+    return now;
+}
+
+sdbusplus::message_t Handler::call(sdbusplus::message_t& method) const
+{
+    dbusCalls++;
+    return bus.call(method);
+}
+
+void Handler::hostPropertiesChanged(sdbusplus::message_t& msg)
+{
+    std::string path = msg.get_path();
+    if (!path.starts_with(HOST_STATE_OBJECT_NAME))
     {
-        lg2::info("Host selector dbus object not available");
-        throw std::invalid_argument("Host selector dbus object not available");
+        return;
     }
 
+    std::string interface;
+    std::map<std::string,
+             std::variant<std::string, std::vector<std::string>>>
+        properties;
     try
     {
-        auto method = bus.new_method_call(
-            HSService.c_str(), HS_DBUS_OBJECT_NAME, propertyIface, "Get");
-        method.append(hostSelectorIface, "Position");
-        auto result = bus.call(method);
+        msg.read(interface, properties);
+    }
+    catch (const std::exception& e)
+    {
+        return;
+    }
 
-        std::variant<size_t> HSPositionVariant;
-        result.read(HSPositionVariant);
+    auto hostNumber = getPathInstance(path);
+    if (!hostNumber)
+    {
+        return;
+    }
+    auto& transition = getHostTransition(*hostNumber);
+    if (transition.service.empty())
+    {
+        // the unique name of the sender, it loses its owner as well when
+        // the state manager exits
+        transition.service = msg.get_sender();
+    }
 
-        auto position = std::get<size_t>(HSPositionVariant);
-        return position;
+    // a transition requested by another client is in flight as well
+    auto requested = properties.find("RequestedHostTransition");
+    if (requested != properties.end())
+    {
+        auto* value = std::get_if<std::string>(&requested->second);
+        if (value != nullptr)
+        {
+            transition.target =
+                (Host::convertTransitionFromString(*value) ==
+                 Host::Transition::Off)
+                    ? Host::HostState::Off
+                    : Host::HostState::Running;
+            transition.requestUsec = getMonotonicUsec();
+        }
     }
-    catch (const sdbusplus::exception_t& e)
+
+    auto current = properties.find("CurrentHostState");
+    if (current != properties.end())
     {
-        lg2::error("Error reading host selector position: {ERROR}", "ERROR", e);
-        throw;
+        auto* value = std::get_if<std::string>(&current->second);
+        if (value != nullptr)
+        {
+            transition.current = Host::convertHostStateFromString(*value);
+            if (transition.target == transition.current)
+            {
+                transition.target.reset();
+            }
+        }
     }
 }
-bool Handler::poweredOn(size_t hostNumber) const
+
+bool Handler::acceptHostTransition(PolicyAction action, size_t hostNumber)
 {
-    auto hostObjectName = HOST_STATE_OBJECT_NAME + std::to_string(hostNumber);
-    auto service = getService(hostObjectName.c_str(), hostIface);
-    auto method = bus.new_method_call(service.c_str(), hostObjectName.c_str(),
-                                      propertyIface, "Get");
-    method.append(hostIface, "CurrentHostState");
-    auto result = bus.call(method);
+    if ((action != PolicyAction::hostOn) &&
+        (action != PolicyAction::hostOff) &&
+        (action != PolicyAction::hostReboot))
+    {
+        // a chassis action is how a stuck host transition gets overridden,
+        // it is never held back
+        return true;
+    }
+
+    auto& transition = getHostTransition(hostNumber);
+    auto now = getMonotonicUsec();
+
+    // the requested state is not reached after the window, the request
+    // was most likely rejected by the state manager
+    if (transition.target &&
+        (now - transition.requestUsec >= HOST_TRANSITION_WINDOW_MS * 1000))
+    {
+        transition.target.reset();
+    }
 
-    std::variant<std::string> state;
-    result.read(state);
+    bool transitioning =
+        (transition.current == Host::HostState::TransitioningToRunning) ||
+        (transition.current == Host::HostState::TransitioningToOff);
+    if (transitioning || transition.target)
+    {
+        transition.dropped++;
+        lg2::info("Host {HOST} is transitioning, dropping {ACTION} "
+                  "({DROPPED} dropped so far)",
+                  "HOST", hostNumber, "ACTION", getActionName(action),
+                  "DROPPED", transition.dropped);
+        return false;
+    }
 
-    return Host::HostState::Off !=
-           Host::convertHostStateFromString(std::get<std::string>(state));
+    transition.target = (action == PolicyAction::hostOff)
+                            ? Host::HostState::Off
+                            : Host::HostState::Running;
+    transition.requestUsec = now;
+    return true;
 }
 
 void Handler::handlePowerEvent(PowerEvent powerEventType,
-                               std::chrono::microseconds duration)
+                               std::chrono::microseconds duration,
+                               size_t instanceHost)
 {
-    std::string objPathName;
-    std::string dbusIfaceName;
-    std::string transitionName;
-    std::variant<Host::Transition, Chassis::Transition> transition;
     uint64_t durationMs =
         std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+    BUTTONS_PROBE(handle_power_event, static_cast<int>(powerEventType),
+                  durationMs, instanceHost);
+    auto callsBefore = dbusCalls;
+
+    // a button instance of a specific host does not follow the selector
+    size_t hostNumber = instanceHost;
+    auto action = PolicyAction::none;
+    ProbeExit probeExit{[&]() {
+        BUTTONS_PROBE(handle_power_event_done, static_cast<int>(action),
+                      hostNumber);
+    }};
+
+    PolicyButton button = PolicyButton::power;
+    PolicyGesture gesture = PolicyGesture::press;
+    switch (powerEventType)
+    {
+        case PowerEvent::powerReleased:
+            if (durationMs > LONG_PRESS_TIME_MS)
+            {
+                gesture = PolicyGesture::longPress;
+            }
+            break;
+        case PowerEvent::powerLongPressed:
+            gesture = PolicyGesture::longPress;
+            break;
+        case PowerEvent::resetReleased:
+            button = PolicyButton::reset;
+            break;
+        default:
+            lg2::error("{EVENT} is invalid power event. skipping...", "EVENT",
+                       static_cast<std::underlying_type_t<PowerEvent>>(
+                           powerEventType));
+            return;
+    }
 
-    size_t hostNumber = 0;
-    auto isMultiHostSystem = isMultiHost();
-    if (isMultiHostSystem)
+    auto selector = PolicySelector::host;
+    if ((instanceHost == 0) && isMultiHost())
     {
         hostNumber = getHostSelectorValue();
         lg2::info("Multi-host system detected : {POSITION}", "POSITION",
                   hostNumber);
+        if (hostNumber == BMC_POSITION)
+        {
+            selector = PolicySelector::bmc;
+        }
     }
 
-    std::string hostNumStr = std::to_string(hostNumber);
+    // only read the host state when the policy depends on it
+    auto hostState = PolicyHostState::off;
+    if (policy.dependsOnHostState(button, gesture, selector) &&
+        poweredOn(hostNumber))
+    {
+        hostState = PolicyHostState::on;
+    }
 
-    // ignore  power and reset button events if BMC is selected.
-    if (isMultiHostSystem && (hostNumber == BMC_POSITION) &&
-        (powerEventType != PowerEvent::powerReleased) &&
-        (durationMs <= LONG_PRESS_TIME_MS))
+    action = policy.lookup(button, gesture, selector, hostState);
+    if (action == PolicyAction::none)
     {
-        lg2::info(
-            "handlePowerEvent : BMC selected on multi-host system. ignoring power and reset button events...");
+        lg2::info("handlePowerEvent : no action for the button event on "
+                  "host {HOST}",
+                  "HOST", hostNumber);
         return;
     }
 
-    switch (powerEventType)
+    lg2::info("handlePowerEvent : {ACTION} on host {HOST}", "ACTION",
+              getActionName(action), "HOST", hostNumber);
+    runPolicyAction(action, hostNumber);
+
+    // the start is the event loop wake-up on the signal, the end is after
+    // the transition call returned
+    uint64_t end = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                       .count();
+    uint64_t latency = end - getMonotonicUsec();
+    actionLatency.record(latency);
+    lg2::info("handlePowerEvent : {ACTION} requested in {LATENCY_US}us, "
+              "p50 {P50_US}us p99 {P99_US}us max {MAX_US}us over {COUNT}, "
+              "{DBUS_CALLS} D-Bus calls",
+              "ACTION", getActionName(action), "LATENCY_US", latency, "P50_US",
+              actionLatency.percentile(0.5), "P99_US",
+              actionLatency.percentile(0.99), "MAX_US", actionLatency.max(),
+              "COUNT", actionLatency.count(), "DBUS_CALLS",
+              dbusCalls - callsBefore);
+}
+
+void Handler::runPolicyAction(PolicyAction action, size_t hostNumber)
+{
+    switch (action)
     {
-        case PowerEvent::powerReleased:
-        {
-            if (durationMs <= LONG_PRESS_TIME_MS)
-            {
-                objPathName = HOST_STATE_OBJECT_NAME + hostNumStr;
-                dbusIfaceName = hostIface;
-                transitionName = "RequestedHostTransition";
+        case PolicyAction::none:
+            return;
+        case PolicyAction::allHostsOn:
+        case PolicyAction::allHostsOff:
+        case PolicyAction::allHostsReboot:
+            startAllHosts(action);
+            return;
+        default:
+            break;
+    }
 
-                transition = Host::Transition::On;
+    if (!acceptHostTransition(action, hostNumber))
+    {
+        return;
+    }
 
-                if (poweredOn(hostNumber))
-                {
-                    transition = Host::Transition::Off;
-                }
-                lg2::info("handlePowerEvent : Handle power button press ");
+    try
+    {
+        auto method = newTransitionCall(action, hostNumber);
+        BUTTONS_PROBE(dbus_call, static_cast<int>(action), hostNumber);
+        call(method);
+        BUTTONS_PROBE(dbus_call_done, static_cast<int>(action), hostNumber,
+                      0);
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        BUTTONS_PROBE(dbus_call_done, static_cast<int>(action), hostNumber,
+                      e.get_errno());
+        getHostTransition(hostNumber).target.reset();
+        throw;
+    }
+}
 
-                break;
-            }
-            else
-            {
-                dbusIfaceName = chassisIface;
-                transitionName = "RequestedPowerTransition";
-                objPathName = CHASSIS_STATE_OBJECT_NAME + hostNumStr;
-                transition = Chassis::Transition::Off;
-
-                /*  multi host system :
-                        hosts (1 to N) - host shutdown
-                        bmc (0) - sled cycle
-                    single host system :
-                        host(0) - host shutdown
-                */
-                if (isMultiHostSystem && (hostNumber == BMC_POSITION))
-                {
-#if CHASSIS_SYSTEM_RESET_ENABLED
-                    objPathName = CHASSISSYSTEM_STATE_OBJECT_NAME + hostNumStr;
-                    transition = Chassis::Transition::PowerCycle;
-#else
-                    return;
-#endif
-                }
-                else if (!poweredOn(hostNumber))
-                {
-                    lg2::info(
-                        "Power is off so ignoring long power button press");
-                    return;
-                }
-                lg2::info("handlePowerEvent : handle long power button press");
-                break;
-            }
-        }
-        case PowerEvent::resetReleased:
+sdbusplus::message_t Handler::newTransitionCall(PolicyAction action,
+                                                size_t hostNumber)
+{
+    std::string objPathName;
+    std::string dbusIfaceName;
+    std::string transitionName;
+    std::variant<Host::Transition, Chassis::Transition> transition;
+    std::string hostNumStr = std::to_string(hostNumber);
+
+    switch (action)
+    {
+        case PolicyAction::hostOn:
+        case PolicyAction::hostOff:
+        case PolicyAction::hostReboot:
         {
             objPathName = HOST_STATE_OBJECT_NAME + hostNumStr;
             dbusIfaceName = hostIface;
             transitionName = "RequestedHostTransition";
-
-            if (!poweredOn(hostNumber))
-            {
-                lg2::info("Power is off so ignoring reset button press");
-                return;
-            }
-
-            lg2::info("Handling reset button press");
-            transition = Host::Transition::Reboot;
+            transition = (action == PolicyAction::hostOn)
+                             ? Host::Transition::On
+                             : ((action == PolicyAction::hostOff)
+                                    ? Host::Transition::Off
+                                    : Host::Transition::Reboot);
             break;
         }
-        default:
+        case PolicyAction::chassisOn:
+        case PolicyAction::chassisOff:
+        case PolicyAction::chassisPowerCycle:
         {
-            lg2::error("{EVENT} is invalid power event. skipping...", "EVENT",
-                       static_cast<std::underlying_type_t<PowerEvent>>(
-                           powerEventType));
-
-            return;
+            objPathName = CHASSIS_STATE_OBJECT_NAME + hostNumStr;
+            dbusIfaceName = chassisIface;
+            transitionName = "RequestedPowerTransition";
+            transition = (action == PolicyAction::chassisOn)
+                             ? Chassis::Transition::On
+                             : ((action == PolicyAction::chassisOff)
+                                    ? Chassis::Transition::Off
+                                    : Chassis::Transition::PowerCycle);
+            break;
+        }
+        case PolicyAction::chassisSystemPowerCycle:
+        {
+            objPathName = CHASSISSYSTEM_STATE_OBJECT_NAME + hostNumStr;
+            dbusIfaceName = chassisIface;
+            transitionName = "RequestedPowerTransition";
+            transition = Chassis::Transition::PowerCycle;
+            break;
         }
+        default:
+            throw std::invalid_argument("Not a single host action");
     }
+
     auto service = getService(objPathName.c_str(), dbusIfaceName);
     auto method = bus.new_method_call(service.c_str(), objPathName.c_str(),
                                       propertyIface, "Set");
     method.append(dbusIfaceName, transitionName, transition);
-    bus.call(method);
+    return method;
+}
+
+size_t Handler::getMaxHostPosition()
+{
+    readHostSelector();
+    return *hostSelector.maxPosition;
+}
+
+void Handler::startAllHosts(PolicyAction action)
+{
+    if (allHosts)
+    {
+        lg2::info("{ACTION} already in progress, ignoring the button event",
+                  "ACTION", getActionName(allHosts->action));
+        return;
+    }
+
+    if (!allHostsTimer)
+    {
+        sd_event_source* timer = nullptr;
+        int ret = sd_event_add_time(bus.get_event(), &timer, CLOCK_MONOTONIC,
+                                    0, 0, allHostsTimerHandler, this);
+        if (ret < 0)
+        {
+            lg2::error("Failed to create the all hosts timer: {RET}", "RET",
+                       ret);
+            return;
+        }
+        sd_event_source_set_enabled(timer, SD_EVENT_OFF);
+        allHostsTimer.reset(timer);
+    }
+
+    AllHostsRequest request;
+    request.action = action;
+    switch (action)
+    {
+        case PolicyAction::allHostsOn:
+            request.hostAction = PolicyAction::hostOn;
+            break;
+        case PolicyAction::allHostsOff:
+            request.hostAction = PolicyAction::hostOff;
+            break;
+        default:
+            request.hostAction = PolicyAction::hostReboot;
+            break;
+    }
+
+    // hosts are numbered from 1 on a multi-host system, 0 is the BMC
+    if (isMultiHost())
+    {
+        auto maxPosition = getMaxHostPosition();
+        for (size_t host = 1; host <= maxPosition; host++)
+        {
+            request.pending.push_back(host);
+        }
+    }
+    else
+    {
+        request.pending.push_back(0);
+    }
+    request.total = request.pending.size();
+
+    const auto& config = policy.getFanOutConfig();
+    lg2::info("Starting {ACTION} on {COUNT} hosts, at most {MAX} at once, "
+              "{STAGGER} ms apart",
+              "ACTION", getActionName(action), "COUNT", request.total, "MAX",
+              config.maxConcurrent, "STAGGER", config.staggerMs);
+
+    allHosts = std::move(request);
+    runAllHosts();
 }
+
+void Handler::runAllHosts()
+{
+    auto& request = *allHosts;
+    const auto& config = policy.getFanOutConfig();
+
+    uint64_t now = 0;
+    sd_event_now(bus.get_event(), CLOCK_MONOTONIC, &now);
+
+    while (!request.pending.empty() &&
+           ((config.maxConcurrent == 0) ||
+            (request.inFlight.size() < config.maxConcurrent)))
+    {
+        if (now < request.nextStartUsec)
+        {
+            sd_event_source_set_time(allHostsTimer.get(),
+                                     request.nextStartUsec);
+            sd_event_source_set_enabled(allHostsTimer.get(),
+                                        SD_EVENT_ONESHOT);
+            return;
+        }
+
+        auto host = request.pending.front();
+        request.pending.pop_front();
+        if (!acceptHostTransition(request.hostAction, host))
+        {
+            request.skipped++;
+            continue;
+        }
+        request.nextStartUsec = now + (config.staggerMs * 1000);
+
+        try
+        {
+            auto method = newTransitionCall(request.hostAction, host);
+            BUTTONS_PROBE(dbus_call, static_cast<int>(request.hostAction),
+                          host);
+            dbusCalls++;
+            request.inFlight.emplace(
+                host, method.call_async(
+                          [this, host](sdbusplus::message_t& reply) {
+                allHostsReply(host, reply);
+            }));
+        }
+        catch (const sdbusplus::exception_t& e)
+        {
+            lg2::error("{ACTION} on host {HOST} failed: {ERROR}", "ACTION",
+                       getActionName(request.hostAction), "HOST", host,
+                       "ERROR", e);
+            getHostTransition(host).target.reset();
+            request.failed++;
+        }
+    }
+
+    if (request.pending.empty() && request.inFlight.empty())
+    {
+        lg2::info("{ACTION} done, {FAILED} of {COUNT} hosts failed, "
+                  "{SKIPPED} already transitioning",
+                  "ACTION", getActionName(request.action), "FAILED",
+                  request.failed, "COUNT", request.total, "SKIPPED",
+                  request.skipped);
+        allHosts.reset();
+    }
+}
+
+void Handler::allHostsReply(size_t host, sdbusplus::message_t& reply)
+{
+    auto& request = *allHosts;
+    BUTTONS_PROBE(dbus_call_done, static_cast<int>(request.hostAction), host,
+                  reply.get_errno());
+    if (reply.is_method_error())
+    {
+        lg2::error("{ACTION} on host {HOST} failed: {ERRNO}", "ACTION",
+                   getActionName(request.hostAction), "HOST", host, "ERRNO",
+                   reply.get_errno());
+        getHostTransition(host).target.reset();
+        request.failed++;
+    }
+    else
+    {
+        lg2::info("{ACTION} on host {HOST} done", "ACTION",
+                  getActionName(request.hostAction), "HOST", host);
+    }
+
+    request.inFlight.erase(host);
+    runAllHosts();
+}
+
+int Handler::allHostsTimerHandler(sd_event_source* /* es */,
+                                  uint64_t /* usec */, void* userdata)
+{
+    auto* handler = static_cast<Handler*>(userdata);
+    if (handler->allHosts)
+    {
+        handler->runAllHosts();
+    }
+    return 0;
+}
+
 void Handler::powerReleased(sdbusplus::message_t& msg)
 {
     try
     {
+        auto* instance = getButtonInstance(msg.get_path());
+        if (instance == nullptr)
+        {
+            return;
+        }
         uint64_t time;
         msg.read(time);
 
+        // the long press action already ran while the button was held. The
+        // duration of the press is not checked, the long press timer of the
+        // buttons daemon runs on the loop clock, so a release edge read
+        // after it ran out can carry a duration just under the threshold.
+        if (std::exchange(instance->longPressHandled, false))
+        {
+            return;
+        }
+
         handlePowerEvent(PowerEvent::powerReleased,
-                         std::chrono::microseconds(time));
+                         std::chrono::microseconds(time), instance->host);
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        constexpr auto powerError =
+            "Failed power state change on a power button press: {ERROR}";
+        if (LogLimiter::instance().allow(this, powerError))
+        {
+            lg2::error(powerError, "ERROR", e);
+        }
+    }
+}
+
+void Handler::powerLongPressed(sdbusplus::message_t& msg)
+{
+    auto* instance = getButtonInstance(msg.get_path());
+    if (instance == nullptr)
+    {
+        return;
+    }
+    instance->longPressHandled = true;
+    try
+    {
+        handlePowerEvent(PowerEvent::powerLongPressed,
+                         std::chrono::milliseconds(LONG_PRESS_TIME_MS),
+                         instance->host);
     }
     catch (const sdbusplus::exception_t& e)
     {
-        lg2::error("Failed power state change on a power button press: {ERROR}",
-                   "ERROR", e);
+        constexpr auto longPressError =
+            "Failed power state change on a power button long press: {ERROR}";
+        if (LogLimiter::instance().allow(this, longPressError))
+        {
+            lg2::error(longPressError, "ERROR", e);
+        }
     }
 }
 
-void Handler::resetReleased(sdbusplus::message_t& /* msg */)
+void Handler::resetReleased(sdbusplus::message_t& msg)
 {
+    auto* instance = getButtonInstance(msg.get_path());
+    if (instance == nullptr)
+    {
+        return;
+    }
     try
     {
         // No need to calculate duration, set to 0.
         handlePowerEvent(PowerEvent::resetReleased,
-                         std::chrono::microseconds(0));
+                         std::chrono::microseconds(0), instance->host);
     }
     catch (const sdbusplus::exception_t& e)
     {
-        lg2::error("Failed power state change on a reset button press: {ERROR}",
-                   "ERROR", e);
+        constexpr auto resetError =
+            "Failed power state change on a reset button press: {ERROR}";
+        if (LogLimiter::instance().allow(this, resetError))
+        {
+            lg2::error(resetError, "ERROR", e);
+        }
     }
 }
 
-void Handler::idReleased(sdbusplus::message_t& /* msg */)
+void Handler::idReleased(sdbusplus::message_t& msg)
 {
+    // all the ID button instances toggle the same identify LED group
+    lg2::debug("ID button {PATH} released", "PATH", msg.get_path());
+    auto callsBefore = dbusCalls;
     std::string groupPath{ledGroupBasePath};
     groupPath += ID_LED_GROUP;
 
@@ -343,7 +1011,7 @@ void Handler::idReleased(sdbusplus::message_t& /* msg */)
         auto method = bus.new_method_call(service.c_str(), groupPath.c_str(),
                                           propertyIface, "Get");
         method.append(ledGroupIface, "Asserted");
-        auto result = bus.call(method);
+        auto result = call(method);
 
         std::variant<bool> state;
         result.read(state);
@@ -358,66 +1026,108 @@ void Handler::idReleased(sdbusplus::message_t& /* msg */)
                                      propertyIface, "Set");
 
         method.append(ledGroupIface, "Asserted", state);
-        result = bus.call(method);
+        result = call(method);
+
+        lg2::debug("ID button press made {DBUS_CALLS} D-Bus calls",
+                   "DBUS_CALLS", dbusCalls - callsBefore);
     }
     catch (const sdbusplus::exception_t& e)
     {
-        lg2::error("Error toggling ID LED group on ID button press: {ERROR}",
-                   "ERROR", e);
+        constexpr auto idError =
+            "Error toggling ID LED group on ID button press: {ERROR}";
+        if (LogLimiter::instance().allow(this, idError))
+        {
+            lg2::error(idError, "ERROR", e);
+        }
     }
 }
 
 void Handler::increaseHostSelectorPosition()
 {
+    auto callsBefore = dbusCalls;
     try
     {
-        auto HSService = getService(HS_DBUS_OBJECT_NAME, hostSelectorIface);
-
-        if (HSService.empty())
+        readHostSelector();
+    }
+    catch (const std::exception& e)
+    {
+        constexpr auto serviceError =
+            "Host selector service not available: {ERROR}";
+        if (LogLimiter::instance().allow(this, serviceError))
         {
-            lg2::error("Host selector service not available");
-            return;
+            lg2::error(serviceError, "ERROR", e);
         }
+        return;
+    }
 
-        auto method =
-            bus.new_method_call(HSService.c_str(), HS_DBUS_OBJECT_NAME,
-                                phosphor::button::propertyIface, "GetAll");
-        method.append(phosphor::button::hostSelectorIface);
-        auto result = bus.call(method);
-        std::unordered_map<std::string, std::variant<size_t>> properties;
-        result.read(properties);
-
-        auto maxPosition = std::get<size_t>(properties.at("MaxPosition"));
-        auto position = std::get<size_t>(properties.at("Position"));
+    auto maxPosition = *hostSelector.maxPosition;
+    auto position = *hostSelector.position;
+    if (maxPosition == 0)
+    {
+        return;
+    }
 
-        std::variant<size_t> HSPositionVariant =
-            (position < maxPosition) ? (position + 1) : 0;
+    // the next position is computed from the local state, so that rapid
+    // presses do not race the signals of the previous ones
+    size_t newPosition = (position < maxPosition) ? (position + 1) : 0;
+    std::variant<size_t> HSPositionVariant = newPosition;
 
-        method = bus.new_method_call(HSService.c_str(), HS_DBUS_OBJECT_NAME,
-                                     phosphor::button::propertyIface, "Set");
+    try
+    {
+        auto method = bus.new_method_call(
+            hostSelector.service.c_str(), HS_DBUS_OBJECT_NAME,
+            phosphor::button::propertyIface, "Set");
         method.append(phosphor::button::hostSelectorIface, "Position");
 
         method.append(HSPositionVariant);
-        result = bus.call(method);
+        call(method);
+
+        hostSelector.position = newPosition;
+        hostSelector.pendingSets.push_back(newPosition);
+
+        lg2::debug("Host selector press made {DBUS_CALLS} D-Bus calls",
+                   "DBUS_CALLS", dbusCalls - callsBefore);
     }
     catch (const sdbusplus::exception_t& e)
     {
-        lg2::error("Error modifying host selector position : {ERROR}", "ERROR",
-                   e);
+        constexpr auto setError =
+            "Error modifying host selector position : {ERROR}";
+        if (LogLimiter::instance().allow(this, setError))
+        {
+            lg2::error(setError, "ERROR", e);
+        }
+
+        // read it again on the next press
+        hostSelector.position.reset();
+        hostSelector.service.clear();
     }
 }
 
+void Handler::debugHostSelectorLongPressed(sdbusplus::message_t& /* msg */)
+{
+    lg2::info("Debug host selector button long press, keeping position");
+    debugHSLongPressHandled = true;
+}
+
 void Handler::debugHostSelectorReleased(sdbusplus::message_t& /* msg */)
 {
+    if (std::exchange(debugHSLongPressHandled, false))
+    {
+        return;
+    }
+
     try
     {
         increaseHostSelectorPosition();
     }
     catch (const sdbusplus::exception_t& e)
     {
-        lg2::error(
-            "Failed power process debug host selector button press : {ERROR}",
-            "ERROR", e);
+        constexpr auto debugError =
+            "Failed power process debug host selector button press : {ERROR}";
+        if (LogLimiter::instance().allow(this, debugError))
+        {
+            lg2::error(debugError, "ERROR", e);
+        }
     }
 }
 
@@ -1,15 +1,42 @@
+#include "config.h"
+
 #include "button_handler.hpp"
+#include "log_limiter.hpp"
+#include "multi_call.hpp"
+#include "startup_stats.hpp"
+
+#include <phosphor-logging/lg2.hpp>
 
+#if MULTI_CALL_ENABLED
+int buttonHandlerMain(int /* argc */, char** /* argv */)
+#else
 int main(void)
+#endif
 {
     auto bus = sdbusplus::bus::new_default();
 
+    sd_event* event = nullptr;
+    int ret = sd_event_default(&event);
+    if (ret < 0)
+    {
+        lg2::error("Error creating a default sd_event handler");
+        return ret;
+    }
+    EventPtr eventP{event};
+    event = nullptr;
+
+    // the event loop drives the timers and asynchronous calls of the handler
+    bus.attach_event(eventP.get(), SD_EVENT_PRIORITY_NORMAL);
+    LogLimiter::instance().attach(eventP);
+
     phosphor::button::Handler handler{bus};
 
-    while (true)
+    logStartup("button-handler");
+    ret = sd_event_loop(eventP.get());
+    if (ret < 0)
     {
-        bus.process_discard();
-        bus.wait();
+        lg2::error("Error occurred during the sd_event_loop : {RESULT}",
+                   "RESULT", ret);
     }
-    return 0;
+    return ret;
 }
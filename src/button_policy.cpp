@@ -0,0 +1,180 @@
+#include "config.h"
+
+#include "button_policy.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace phosphor
+{
+namespace button
+{
+
+namespace
+{
+
+template <typename T>
+using NameMap = std::array<std::pair<std::string_view, T>,
+                           static_cast<size_t>(T::count)>;
+
+constexpr NameMap<PolicyButton> buttonNames{
+    {{"power", PolicyButton::power}, {"reset", PolicyButton::reset}}};
+
+constexpr NameMap<PolicyGesture> gestureNames{
+    {{"press", PolicyGesture::press},
+     {"long_press", PolicyGesture::longPress}}};
+
+constexpr NameMap<PolicySelector> selectorNames{
+    {{"host", PolicySelector::host}, {"bmc", PolicySelector::bmc}}};
+
+constexpr NameMap<PolicyHostState> hostStateNames{
+    {{"off", PolicyHostState::off}, {"on", PolicyHostState::on}}};
+
+constexpr std::array<std::pair<std::string_view, PolicyAction>, 11>
+    actionNames{{{"none", PolicyAction::none},
+                 {"host_on", PolicyAction::hostOn},
+                 {"host_off", PolicyAction::hostOff},
+                 {"host_reboot", PolicyAction::hostReboot},
+                 {"chassis_on", PolicyAction::chassisOn},
+                 {"chassis_off", PolicyAction::chassisOff},
+                 {"chassis_power_cycle", PolicyAction::chassisPowerCycle},
+                 {"chassis_system_power_cycle",
+                  PolicyAction::chassisSystemPowerCycle},
+                 {"all_hosts_on", PolicyAction::allHostsOn},
+                 {"all_hosts_off", PolicyAction::allHostsOff},
+                 {"all_hosts_reboot", PolicyAction::allHostsReboot}}};
+
+/**
+ * @brief resolves a rule field to the list of values it matches, "any"
+ * matches all of them
+ *
+ * @return std::nullopt if the name is unknown
+ */
+template <typename T>
+std::optional<std::vector<T>> matchField(const NameMap<T>& names,
+                                         const std::string& name)
+{
+    std::vector<T> values;
+    for (const auto& [valueName, value] : names)
+    {
+        if ((name == "any") || (name == valueName))
+        {
+            values.push_back(value);
+        }
+    }
+    if (values.empty())
+    {
+        return std::nullopt;
+    }
+    return values;
+}
+
+} // namespace
+
+ButtonPolicy::ButtonPolicy()
+{
+    constexpr auto power = PolicyButton::power;
+    constexpr auto reset = PolicyButton::reset;
+    constexpr auto press = PolicyGesture::press;
+    constexpr auto longPress = PolicyGesture::longPress;
+    constexpr auto host = PolicySelector::host;
+    constexpr auto bmc = PolicySelector::bmc;
+    constexpr auto off = PolicyHostState::off;
+    constexpr auto on = PolicyHostState::on;
+
+    // short power press toggles the host power
+    set(power, press, host, off, PolicyAction::hostOn);
+    set(power, press, host, on, PolicyAction::hostOff);
+    set(power, press, bmc, off, PolicyAction::hostOn);
+    set(power, press, bmc, on, PolicyAction::hostOff);
+
+    // long power press turns the chassis off, on a multi-host system with
+    // the BMC selected it power cycles the whole sled
+    set(power, longPress, host, on, PolicyAction::chassisOff);
+#if CHASSIS_SYSTEM_RESET_ENABLED
+    set(power, longPress, bmc, off, PolicyAction::chassisSystemPowerCycle);
+    set(power, longPress, bmc, on, PolicyAction::chassisSystemPowerCycle);
+#endif
+
+    // reset reboots a running host
+    set(reset, press, host, on, PolicyAction::hostReboot);
+    set(reset, longPress, host, on, PolicyAction::hostReboot);
+}
+
+void ButtonPolicy::load(const nlohmann::json& policyJson)
+{
+    if (policyJson.contains("fan_out"))
+    {
+        const auto& fanOutJson = policyJson["fan_out"];
+        fanOut.maxConcurrent = fanOutJson.value("max_concurrent",
+                                                fanOut.maxConcurrent);
+        fanOut.staggerMs = fanOutJson.value("stagger_ms", fanOut.staggerMs);
+    }
+
+    if (!policyJson.contains("policy"))
+    {
+        return;
+    }
+
+    for (const auto& rule : policyJson["policy"])
+    {
+        auto buttons = matchField(buttonNames,
+                                  rule.value("button", std::string("any")));
+        auto gestures = matchField(gestureNames,
+                                   rule.value("gesture", std::string("any")));
+        auto selectors = matchField(selectorNames,
+                                    rule.value("selector", std::string("any")));
+        auto hostStates = matchField(
+            hostStateNames, rule.value("host_state", std::string("any")));
+
+        std::optional<PolicyAction> action;
+        auto actionName = rule.value("action", std::string());
+        for (const auto& [name, value] : actionNames)
+        {
+            if (actionName == name)
+            {
+                action = value;
+            }
+        }
+
+        if (!buttons || !gestures || !selectors || !hostStates || !action)
+        {
+            lg2::error("Invalid button policy rule, skipping: {RULE}", "RULE",
+                       rule.dump());
+            continue;
+        }
+
+        for (auto button : *buttons)
+        {
+            for (auto gesture : *gestures)
+            {
+                for (auto selector : *selectors)
+                {
+                    for (auto hostState : *hostStates)
+                    {
+                        set(button, gesture, selector, hostState, *action);
+                    }
+                }
+            }
+        }
+    }
+}
+
+std::string getActionName(PolicyAction action)
+{
+    for (const auto& [name, value] : actionNames)
+    {
+        if (value == action)
+        {
+            return std::string(name);
+        }
+    }
+    return "unknown";
+}
+
+} // namespace button
+} // namespace phosphor
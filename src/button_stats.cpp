@@ -0,0 +1,239 @@
+#include "button_stats.hpp"
+
+#include "private_interfaces.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+#include <sdbusplus/vtable.hpp>
+
+#include <array>
+#include <string_view>
+
+namespace
+{
+
+constexpr std::array<const char*, 9> propertyNames = {
+    "Level", "PressCount", "BounceCount", "LastPressDuration", "LastEdgeTime",
+    "SignalLatencyP50", "SignalLatencyP99", "SignalLatencyMax", "PeakEdgeRate"};
+
+constexpr uint64_t rateWindowLengthUsec = 1000 * 1000;
+
+} // namespace
+
+static const sd_bus_vtable statsVtable[] = {
+    sdbusplus::vtable::start(),
+    sdbusplus::vtable::property("Level", "u", ButtonStats::getProperty,
+                                sdbusplus::vtable::property_::emits_change),
+    sdbusplus::vtable::property("PressCount", "t", ButtonStats::getProperty,
+                                sdbusplus::vtable::property_::emits_change),
+    sdbusplus::vtable::property("BounceCount", "t", ButtonStats::getProperty,
+                                sdbusplus::vtable::property_::emits_change),
+    sdbusplus::vtable::property("LastPressDuration", "t",
+                                ButtonStats::getProperty,
+                                sdbusplus::vtable::property_::emits_change),
+    sdbusplus::vtable::property("LastEdgeTime", "t", ButtonStats::getProperty,
+                                sdbusplus::vtable::property_::emits_change),
+    sdbusplus::vtable::property("SignalLatencyP50", "t",
+                                ButtonStats::getProperty,
+                                sdbusplus::vtable::property_::emits_change),
+    sdbusplus::vtable::property("SignalLatencyP99", "t",
+                                ButtonStats::getProperty,
+                                sdbusplus::vtable::property_::emits_change),
+    sdbusplus::vtable::property("SignalLatencyMax", "t",
+                                ButtonStats::getProperty,
+                                sdbusplus::vtable::property_::emits_change),
+    sdbusplus::vtable::property("PeakEdgeRate", "t", ButtonStats::getProperty,
+                                sdbusplus::vtable::property_::emits_change),
+    sdbusplus::vtable::end()};
+
+ButtonStats::ButtonStats(sdbusplus::bus_t& bus, EventPtr& event,
+                         const char* path, size_t lineCount) :
+    bus(bus),
+    event(event), path(path),
+    statsIface(bus, path, buttons_private::statisticsIface, statsVtable, this),
+    edgeTimes(lineCount), pressTimes(lineCount)
+{}
+
+void ButtonStats::update(size_t line, GpioState state, uint64_t timestamp)
+{
+    if ((line >= edgeTimes.size()) || (line >= 32))
+    {
+        return;
+    }
+
+    uint32_t mask = 1U << line;
+    bool asserted = (state == GpioState::assert);
+    bool wasAsserted = (levels & mask) != 0;
+
+    // the level before the first edge is not known, a release with no
+    // press before it is not a bounce
+    const auto& lastEdge = edgeTimes[line];
+    if (lastEdge && ((asserted == wasAsserted) ||
+                     (timestamp - *lastEdge < bounceWindowUsec)))
+    {
+        bounces++;
+        dirty.set(bounceCount);
+    }
+    edgeTimes[line] = timestamp;
+
+    if (asserted != wasAsserted)
+    {
+        levels ^= mask;
+        dirty.set(level);
+
+        if (asserted)
+        {
+            presses++;
+            pressTimes[line] = timestamp;
+            dirty.set(pressCount);
+        }
+        else if (pressTimes[line])
+        {
+            lastPressUsec = timestamp - *pressTimes[line];
+            dirty.set(lastPressDuration);
+        }
+    }
+
+    lastEdgeUsec = timestamp;
+    dirty.set(lastEdgeTime);
+
+    if (timestamp - rateWindowUsec >= rateWindowLengthUsec)
+    {
+        rateWindowUsec = timestamp;
+        rateWindowEdges = 0;
+    }
+    if (++rateWindowEdges > peakRate)
+    {
+        peakRate = rateWindowEdges;
+        dirty.set(peakEdgeRate);
+    }
+
+    scheduleEmit();
+}
+
+void ButtonStats::recordSignalLatency(uint64_t usec)
+{
+    latency.record(usec);
+    dirty.set(signalLatencyP50);
+    dirty.set(signalLatencyP99);
+    dirty.set(signalLatencyMax);
+    scheduleEmit();
+}
+
+void ButtonStats::scheduleEmit()
+{
+    if (emitTimer)
+    {
+        int enabled = SD_EVENT_OFF;
+        sd_event_source_get_enabled(emitTimer.get(), &enabled);
+        if (enabled != SD_EVENT_OFF)
+        {
+            // the pending signal carries this change too
+            return;
+        }
+    }
+
+    uint64_t now = 0;
+    sd_event_now(event.get(), CLOCK_MONOTONIC, &now);
+    if (now - lastEmitUsec >= statsEmitIntervalUsec)
+    {
+        emitChanged();
+        lastEmitUsec = now;
+        return;
+    }
+
+    uint64_t next = lastEmitUsec + statsEmitIntervalUsec;
+    if (!emitTimer)
+    {
+        sd_event_source* timer = nullptr;
+        int ret = sd_event_add_time(event.get(), &timer, CLOCK_MONOTONIC,
+                                    next, 0, emitHandler, this);
+        if (ret < 0)
+        {
+            lg2::error("Failed to create the statistics timer: {RET}", "RET",
+                       ret);
+            return;
+        }
+        emitTimer.reset(timer);
+    }
+    sd_event_source_set_time(emitTimer.get(), next);
+    sd_event_source_set_enabled(emitTimer.get(), SD_EVENT_ONESHOT);
+}
+
+void ButtonStats::emitChanged()
+{
+    std::array<char*, propertyNames.size() + 1> names{};
+    size_t count = 0;
+    for (size_t property = 0; property < propertyNames.size(); property++)
+    {
+        if (dirty.test(property))
+        {
+            names[count++] = const_cast<char*>(propertyNames[property]);
+        }
+    }
+    dirty.reset();
+
+    if (count > 0)
+    {
+        sd_bus_emit_properties_changed_strv(bus.get(), path.c_str(),
+                                            buttons_private::statisticsIface,
+                                            names.data());
+    }
+}
+
+int ButtonStats::emitHandler(sd_event_source* /* es */, uint64_t usec,
+                             void* userdata)
+{
+    auto* stats = static_cast<ButtonStats*>(userdata);
+    stats->emitChanged();
+    stats->lastEmitUsec = usec;
+    return 0;
+}
+
+int ButtonStats::getProperty(sd_bus* /* bus */, const char* /* path */,
+                             const char* /* interface */, const char* property,
+                             sd_bus_message* reply, void* userdata,
+                             sd_bus_error* /* error */)
+{
+    auto* stats = static_cast<ButtonStats*>(userdata);
+    std::string_view name{property};
+
+    if (name == "Level")
+    {
+        return sd_bus_message_append(reply, "u", stats->levels);
+    }
+
+    uint64_t value = 0;
+    if (name == "PressCount")
+    {
+        value = stats->presses;
+    }
+    else if (name == "BounceCount")
+    {
+        value = stats->bounces;
+    }
+    else if (name == "LastPressDuration")
+    {
+        value = stats->lastPressUsec;
+    }
+    else if (name == "LastEdgeTime")
+    {
+        value = stats->lastEdgeUsec;
+    }
+    else if (name == "SignalLatencyP50")
+    {
+        value = stats->latency.percentile(0.5);
+    }
+    else if (name == "SignalLatencyP99")
+    {
+        value = stats->latency.percentile(0.99);
+    }
+    else if (name == "SignalLatencyMax")
+    {
+        value = stats->latency.max();
+    }
+    else if (name == "PeakEdgeRate")
+    {
+        value = stats->peakRate;
+    }
+    return sd_bus_message_append(reply, "t", value);
+}
@@ -1,6 +1,5 @@
 #include "debugHostSelector_button.hpp"
-// add the button iface class to registry
-static ButtonIFRegister<DebugHostSelector> buttonRegister;
+
 using namespace phosphor::logging;
 
 void DebugHostSelector::simPress()
@@ -18,6 +17,14 @@ void DebugHostSelector::simLongPress()
     pressedLong();
 }
 
+void DebugHostSelector::longPressed()
+{
+    lg2::info("Button long pressed : {FORM_FACTOR_TYPE}", "FORM_FACTOR_TYPE",
+              getFormFactorType());
+    // emit long pressed signal while the button is still held
+    pressedLong();
+}
+
 /**
  * @brief This method is called from sd-event provided callback function
  * callbackHandler if platform specific event handling is needed then a
@@ -28,31 +35,17 @@ void DebugHostSelector::simLongPress()
 void DebugHostSelector::handleEvent(sd_event_source* /* es */, int fd,
                                     uint32_t /* revents*/)
 {
-    int n = -1;
-    char buf = '0';
-
-    n = ::lseek(fd, 0, SEEK_SET);
-
-    if (n < 0)
+    auto edge = readEdge(fd);
+    if (!edge)
     {
-        lg2::error("GPIO fd lseek error!  : {FORM_FACTOR_TYPE}",
-                   "FORM_FACTOR_TYPE", getFormFactorType());
         return;
     }
 
-    n = ::read(fd, &buf, sizeof(buf));
-    if (n < 0)
-    {
-        lg2::error("GPIO fd read error!  : {FORM_FACTOR_TYPE}",
-                   "FORM_FACTOR_TYPE", getFormFactorType());
-        throw sdbusplus::xyz::openbmc_project::Chassis::Common::Error::
-            IOError();
-    }
-
-    if (buf == '0')
+    if (edge->state == GpioState::assert)
     {
         lg2::info("Button pressed : {FORM_FACTOR_TYPE}", "FORM_FACTOR_TYPE",
                   getFormFactorType());
+        startLongPressTimer(edge->timestamp);
         // emit pressed signal
         pressed();
     }
@@ -60,6 +53,7 @@ void DebugHostSelector::handleEvent(sd_event_source* /* es */, int fd,
     {
         lg2::info("Button released{FORM_FACTOR_TYPE}", "FORM_FACTOR_TYPE",
                   getFormFactorType());
+        stopLongPressTimer();
         // emit released signal
         released();
     }
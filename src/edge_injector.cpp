@@ -0,0 +1,89 @@
+#include "edge_injector.hpp"
+
+#include "private_interfaces.hpp"
+
+#include <sdbusplus/vtable.hpp>
+
+#include <algorithm>
+#include <string>
+#include <tuple>
+#include <vector>
+
+static const sd_bus_vtable injectorVtable[] = {
+    sdbusplus::vtable::start(),
+    sdbusplus::vtable::method("InjectEdges", "oa(ubt)", "at",
+                              EdgeInjector::injectHandler),
+    sdbusplus::vtable::end()};
+
+EdgeInjector::EdgeInjector(sdbusplus::bus_t& bus, const char* path,
+                           std::vector<std::unique_ptr<ButtonIface>>& buttons) :
+    buttons(buttons),
+    injectorIface(bus, path, buttons_private::injectorIface, injectorVtable,
+                  this)
+{}
+
+int EdgeInjector::injectHandler(sd_bus_message* msg, void* userdata,
+                                sd_bus_error* error)
+{
+    auto* injector = static_cast<EdgeInjector*>(userdata);
+    sdbusplus::message_t message{msg};
+
+    sdbusplus::message::object_path path;
+    std::vector<std::tuple<uint32_t, bool, uint64_t>> edges;
+    try
+    {
+        message.read(path, edges);
+    }
+    catch (const sdbusplus::exception_t&)
+    {
+        return sd_bus_error_set(error, SD_BUS_ERROR_INVALID_ARGS,
+                                "Malformed edge batch");
+    }
+
+    if (edges.size() > edgeInjectorMaxBatch)
+    {
+        return sd_bus_error_set(error, SD_BUS_ERROR_LIMITS_EXCEEDED,
+                                "Too many edges in the batch");
+    }
+
+    auto it = std::find_if(injector->buttons.begin(), injector->buttons.end(),
+                           [&path](const auto& button) {
+        return button->getObjectPath() == std::string(path);
+    });
+    if (it == injector->buttons.end())
+    {
+        return sd_bus_error_set(error, SD_BUS_ERROR_INVALID_ARGS,
+                                "Unknown button");
+    }
+
+    uint64_t now = getMonotonicUsec();
+    for (const auto& [line, high, timestamp] : edges)
+    {
+        if ((timestamp > now) ||
+            ((timestamp != 0) && (now - timestamp > edgeInjectorMaxAgeUsec)))
+        {
+            return sd_bus_error_set(error, SD_BUS_ERROR_INVALID_ARGS,
+                                    "Edge timestamp out of range");
+        }
+    }
+
+    std::vector<uint64_t> durations;
+    durations.reserve(edges.size());
+    for (const auto& [line, high, timestamp] : edges)
+    {
+        GpioEdge edge{high, (timestamp != 0) ? timestamp : getMonotonicUsec(),
+                      true};
+        auto duration = (*it)->injectEdge(line, edge);
+        if (!duration)
+        {
+            return sd_bus_error_set(error, SD_BUS_ERROR_INVALID_ARGS,
+                                    "Gpio line not available");
+        }
+        durations.push_back(*duration);
+    }
+
+    auto reply = message.new_method_return();
+    reply.append(durations);
+    reply.method_return();
+    return 1;
+}
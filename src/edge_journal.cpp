@@ -0,0 +1,137 @@
+#include "edge_journal.hpp"
+
+#include "private_interfaces.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sdbusplus/vtable.hpp>
+
+#include <csignal>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <vector>
+
+static const sd_bus_vtable journalVtable[] = {
+    sdbusplus::vtable::start(),
+    sdbusplus::vtable::method("Dump", "", "a(tsubs)",
+                              EdgeJournalDump::dumpHandler),
+    sdbusplus::vtable::end()};
+
+const char* getEdgeActionName(EdgeAction action)
+{
+    switch (action)
+    {
+        case EdgeAction::edge:
+            return "edge";
+        case EdgeAction::longPressed:
+            return "long_pressed";
+        case EdgeAction::readError:
+            return "read_error";
+        case EdgeAction::recovered:
+            return "recovered";
+    }
+    return "unknown";
+}
+
+namespace
+{
+
+// only async-signal-safe calls from here on, so no stdio
+void appendString(char* buf, size_t& pos, size_t size, const char* str)
+{
+    while ((*str != '\0') && (pos < size))
+    {
+        buf[pos++] = *str++;
+    }
+}
+
+void appendNumber(char* buf, size_t& pos, size_t size, uint64_t value)
+{
+    char digits[20];
+    size_t count = 0;
+    do
+    {
+        digits[count++] = static_cast<char>('0' + (value % 10));
+        value /= 10;
+    } while (value != 0);
+
+    while ((count > 0) && (pos < size))
+    {
+        buf[pos++] = digits[--count];
+    }
+}
+
+} // namespace
+
+void EdgeJournal::installCrashHandler(const char* path)
+{
+    crashFile = path;
+
+    struct sigaction action{};
+    action.sa_handler = crashHandler;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+    for (int signal : {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT})
+    {
+        sigaction(signal, &action, nullptr);
+    }
+}
+
+void EdgeJournal::crashHandler(int signal)
+{
+    const auto& journal = instance();
+    int fd = ::open(journal.crashFile, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                    0644);
+    if (fd >= 0)
+    {
+        journal.forEach([fd](const EdgeJournalEntry& entry) {
+            char line[128];
+            size_t pos = 0;
+            appendNumber(line, pos, sizeof(line), entry.timestamp);
+            appendString(line, pos, sizeof(line), " ");
+            appendString(line, pos, sizeof(line),
+                         (entry.button != nullptr) ? entry.button : "-");
+            appendString(line, pos, sizeof(line), " ");
+            appendNumber(line, pos, sizeof(line), entry.line);
+            const char* level = " - ";
+            if (entry.state != GpioState::invalid)
+            {
+                level = (entry.state == GpioState::assert) ? " 1 " : " 0 ";
+            }
+            appendString(line, pos, sizeof(line), level);
+            appendString(line, pos, sizeof(line),
+                         getEdgeActionName(entry.action));
+            appendString(line, pos, sizeof(line), "\n");
+            [[maybe_unused]] auto n = ::write(fd, line, pos);
+        });
+        ::close(fd);
+    }
+
+    // the handler was reset, the default action now runs
+    std::raise(signal);
+}
+
+EdgeJournalDump::EdgeJournalDump(sdbusplus::bus_t& bus, const char* path) :
+    dumpIface(bus, path, buttons_private::journalIface, journalVtable, this)
+{}
+
+int EdgeJournalDump::dumpHandler(sd_bus_message* msg, void* /* userdata */,
+                                 sd_bus_error* /* error */)
+{
+    std::vector<std::tuple<uint64_t, std::string, uint32_t, bool, std::string>>
+        entries;
+    EdgeJournal::instance().forEach([&entries](const EdgeJournalEntry& entry) {
+        entries.emplace_back(entry.timestamp,
+                             (entry.button != nullptr) ? entry.button : "",
+                             entry.line, entry.state == GpioState::assert,
+                             getEdgeActionName(entry.action));
+    });
+
+    sdbusplus::message_t message{msg};
+    auto reply = message.new_method_return();
+    reply.append(entries);
+    reply.method_return();
+    return 1;
+}
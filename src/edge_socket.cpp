@@ -0,0 +1,226 @@
+#include "edge_socket.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+// a subscriber closing its end must not raise SIGPIPE in the daemon
+constexpr int sendFlags = MSG_DONTWAIT | MSG_NOSIGNAL;
+
+EdgeSocket::EdgeSocket(EventPtr& event, const char* path) : event(event)
+{
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (std::strlen(path) >= sizeof(addr.sun_path))
+    {
+        lg2::error("Edge socket path {PATH} is too long", "PATH", path);
+        return;
+    }
+    std::strcpy(addr.sun_path, path);
+
+    listenFd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                        0);
+    if (listenFd < 0)
+    {
+        lg2::error("Failed to create the edge socket: {ERROR}", "ERROR", errno);
+        return;
+    }
+
+    // left over by a previous run
+    ::unlink(path);
+
+    auto* sockAddr = reinterpret_cast<sockaddr*>(&addr);
+    if ((::bind(listenFd, sockAddr, sizeof(addr)) < 0) ||
+        (::listen(listenFd, edgeSocketMaxSubscribers) < 0))
+    {
+        lg2::error("Failed to listen on the edge socket {PATH}: {ERROR}",
+                   "PATH", path, "ERROR", errno);
+        ::close(listenFd);
+        listenFd = -1;
+        return;
+    }
+
+    sd_event_source* source = nullptr;
+    int ret = sd_event_add_io(event.get(), &source, listenFd, EPOLLIN,
+                              acceptHandler, this);
+    if (ret < 0)
+    {
+        lg2::error("Failed to add the edge socket to the event loop: {RET}",
+                   "RET", ret);
+        ::close(listenFd);
+        listenFd = -1;
+        return;
+    }
+    listenSource.reset(source);
+
+    lg2::info("Streaming the gpio edges on {PATH}", "PATH", path);
+}
+
+EdgeSocket::~EdgeSocket()
+{
+    for (auto& subscriber : subscribers)
+    {
+        subscriber.source.reset();
+        ::close(subscriber.fd);
+    }
+    listenSource.reset();
+    if (listenFd >= 0)
+    {
+        ::close(listenFd);
+    }
+}
+
+int EdgeSocket::acceptHandler(sd_event_source* /* es */, int fd,
+                              uint32_t /* revents */, void* userdata)
+{
+    auto* socket = static_cast<EdgeSocket*>(userdata);
+
+    int clientFd = ::accept4(fd, nullptr, nullptr,
+                             SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (clientFd < 0)
+    {
+        return 0;
+    }
+
+    if (socket->subscribers.size() >= edgeSocketMaxSubscribers)
+    {
+        lg2::error("Too many edge socket subscribers, refusing a new one");
+        ::close(clientFd);
+        return 0;
+    }
+
+    auto& subscriber = socket->subscribers.emplace_back();
+    subscriber.socket = socket;
+    subscriber.fd = clientFd;
+
+    // EPOLLIN reports the hang up of the subscriber, EPOLLOUT is only
+    // enabled while records are queued
+    sd_event_source* source = nullptr;
+    int ret = sd_event_add_io(socket->event.get(), &source, clientFd, EPOLLIN,
+                              subscriberHandler, &subscriber);
+    if (ret < 0)
+    {
+        lg2::error("Failed to add an edge socket subscriber: {RET}", "RET",
+                   ret);
+        ::close(clientFd);
+        socket->subscribers.pop_back();
+        return 0;
+    }
+    subscriber.source.reset(source);
+
+    lg2::info("New edge socket subscriber, {COUNT} in total", "COUNT",
+              socket->subscribers.size());
+    return 0;
+}
+
+int EdgeSocket::subscriberHandler(sd_event_source* /* es */, int fd,
+                                  uint32_t revents, void* userdata)
+{
+    auto& subscriber = *static_cast<Subscriber*>(userdata);
+
+    if (revents & EPOLLIN)
+    {
+        // subscribers are not expected to send anything
+        char buf[64];
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        if ((n == 0) || ((n < 0) && (errno != EAGAIN)))
+        {
+            subscriber.socket->removeSubscriber(subscriber);
+            return 0;
+        }
+    }
+
+    if (revents & (EPOLLHUP | EPOLLERR))
+    {
+        subscriber.socket->removeSubscriber(subscriber);
+        return 0;
+    }
+
+    if ((revents & EPOLLOUT) && !subscriber.socket->flush(subscriber))
+    {
+        subscriber.socket->removeSubscriber(subscriber);
+    }
+    return 0;
+}
+
+void EdgeSocket::removeSubscriber(Subscriber& subscriber)
+{
+    lg2::info("Edge socket subscriber left, {OVERFLOWS} records dropped",
+              "OVERFLOWS", subscriber.overflows);
+
+    subscriber.source.reset();
+    ::close(subscriber.fd);
+    subscribers.remove_if(
+        [&subscriber](const Subscriber& s) { return &s == &subscriber; });
+}
+
+bool EdgeSocket::flush(Subscriber& subscriber)
+{
+    while (subscriber.count > 0)
+    {
+        auto& record = subscriber.ring[subscriber.head];
+        if (::send(subscriber.fd, &record, sizeof(record), sendFlags) < 0)
+        {
+            return (errno == EAGAIN) || (errno == EWOULDBLOCK);
+        }
+        subscriber.head = (subscriber.head + 1) % edgeSocketRingSize;
+        subscriber.count--;
+    }
+
+    sd_event_source_set_io_events(subscriber.source.get(), EPOLLIN);
+    return true;
+}
+
+void EdgeSocket::queue(Subscriber& subscriber, EdgeSocketRecord& record)
+{
+    record.overflows = subscriber.overflows;
+
+    // nothing queued, try to send at once
+    if (subscriber.count == 0)
+    {
+        if (::send(subscriber.fd, &record, sizeof(record), sendFlags) >= 0)
+        {
+            return;
+        }
+        if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+        {
+            // the hang up is handled by the event source
+            return;
+        }
+        sd_event_source_set_io_events(subscriber.source.get(),
+                                      EPOLLIN | EPOLLOUT);
+    }
+
+    if (subscriber.count == edgeSocketRingSize)
+    {
+        subscriber.overflows++;
+        return;
+    }
+
+    auto tail = (subscriber.head + subscriber.count) % edgeSocketRingSize;
+    subscriber.ring[tail] = record;
+    subscriber.count++;
+}
+
+void EdgeSocket::handleEdge(const EdgeEvent& edge)
+{
+    EdgeSocketRecord record{};
+    record.timestamp = edge.timestamp;
+    record.sequence = sequence++;
+    auto size = std::min(edge.button.size(), sizeof(record.button) - 1);
+    std::memcpy(record.button, edge.button.data(), size);
+    record.instance = static_cast<uint32_t>(edge.instance);
+    record.line = edge.line;
+    record.level = (edge.state == GpioState::assert) ? 1 : 0;
+
+    for (auto& subscriber : subscribers)
+    {
+        queue(subscriber, record);
+    }
+}
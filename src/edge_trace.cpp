@@ -0,0 +1,158 @@
+#include "edge_trace.hpp"
+
+#include "gpio_backend.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <cerrno>
+#include <fstream>
+
+bool EdgeTrace::open(const std::string& path)
+{
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        lg2::error("Failed to create the edge trace {PATH}: {ERROR}", "PATH",
+                   path, "ERROR", errno);
+        return false;
+    }
+
+    EdgeTraceHeader header{edgeTraceMagic, edgeTraceVersion};
+    if (::write(fd, &header, sizeof(header)) != sizeof(header))
+    {
+        lg2::error("Failed to write the edge trace {PATH}: {ERROR}", "PATH",
+                   path, "ERROR", errno);
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    lg2::info("Recording the gpio edges to {PATH}", "PATH", path);
+    return true;
+}
+
+EdgeTrace::~EdgeTrace()
+{
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+}
+
+void EdgeTrace::record(uint32_t number, const GpioEdge& edge)
+{
+    if (fd < 0)
+    {
+        return;
+    }
+
+    EdgeTraceRecord record{edge.timestamp, number, edge.high ? 1U : 0U};
+    if (::write(fd, &record, sizeof(record)) != sizeof(record))
+    {
+        lg2::error("Stopped recording the gpio edges: {ERROR}", "ERROR",
+                   errno);
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+EdgeTraceReplay::EdgeTraceReplay(EventPtr& event, SimGpioBackend& backend,
+                                 const std::string& path, bool realTime) :
+    event(event),
+    backend(backend), realTime(realTime)
+{
+    std::ifstream trace{path, std::ios::binary};
+    EdgeTraceHeader header{};
+    if (!trace.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        (header.magic != edgeTraceMagic) ||
+        (header.version != edgeTraceVersion))
+    {
+        lg2::error("{PATH} is not an edge trace", "PATH", path);
+        return;
+    }
+
+    EdgeTraceRecord record{};
+    while (trace.read(reinterpret_cast<char*>(&record), sizeof(record)))
+    {
+        records.push_back(record);
+    }
+    lg2::info("Loaded {COUNT} edges from {PATH}", "COUNT", records.size(),
+              "PATH", path);
+}
+
+bool EdgeTraceReplay::start()
+{
+    if (records.empty())
+    {
+        return false;
+    }
+
+    sd_event_now(event.get(), CLOCK_MONOTONIC, &startUsec);
+    traceStartUsec = records.front().timestamp;
+    next = 0;
+    scheduleNext();
+    return true;
+}
+
+void EdgeTraceReplay::scheduleNext()
+{
+    // in the fast mode the timer is already due, its idle priority lets the
+    // daemon handle the previous edge first
+    uint64_t due = 0;
+    if (realTime)
+    {
+        due = startUsec + (records[next].timestamp - traceStartUsec);
+    }
+
+    if (!timer)
+    {
+        sd_event_source* source = nullptr;
+        int ret = sd_event_add_time(event.get(), &source, CLOCK_MONOTONIC, due,
+                                    0, replayHandler, this);
+        if (ret < 0)
+        {
+            lg2::error("Failed to create the replay timer: {RET}", "RET", ret);
+            return;
+        }
+        timer.reset(source);
+        sd_event_source_set_priority(source, SD_EVENT_PRIORITY_IDLE);
+        return;
+    }
+    sd_event_source_set_time(timer.get(), due);
+    sd_event_source_set_enabled(timer.get(), SD_EVENT_ONESHOT);
+}
+
+int EdgeTraceReplay::replayHandler(sd_event_source* /* es */,
+                                   uint64_t /* usec */, void* userdata)
+{
+    auto* replay = static_cast<EdgeTraceReplay*>(userdata);
+    const auto& record = replay->records[replay->next];
+
+    // both modes keep the trace spacing from the start of the replay, the
+    // fast one runs ahead of the loop clock
+    uint64_t timestamp = replay->startUsec +
+                         (record.timestamp - replay->traceStartUsec);
+
+    // the handling of a replayed edge is not a latency of the system
+    GpioEdge edge{record.high != 0, timestamp, true};
+    if (!replay->backend.inject(record.number, edge))
+    {
+        lg2::error("Replayed gpio-{NUM} is not configured", "NUM",
+                   record.number);
+    }
+
+    if (++replay->next < replay->records.size())
+    {
+        replay->scheduleNext();
+        return 0;
+    }
+
+    uint64_t now = 0;
+    sd_event_now(replay->event.get(), CLOCK_MONOTONIC, &now);
+    lg2::info("Replayed {COUNT} edges in {DURATION}us", "COUNT",
+              replay->records.size(), "DURATION", now - replay->startUsec);
+    return 0;
+}
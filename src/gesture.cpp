@@ -0,0 +1,288 @@
+#include "gesture.hpp"
+
+#include "private_interfaces.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+#include <sdbusplus/vtable.hpp>
+
+#include <algorithm>
+
+static const sd_bus_vtable gestureVtable[] = {
+    sdbusplus::vtable::start(),
+    sdbusplus::vtable::signal("Recognized", "st"),
+    sdbusplus::vtable::end()};
+
+GestureEngine::GestureEngine(sdbusplus::bus_t& bus, EventPtr& event,
+                             const nlohmann::json& gestureDefs) :
+    bus(bus),
+    event(event)
+{
+    for (const auto& gestureDef : gestureDefs)
+    {
+        auto gesture = std::make_unique<Gesture>();
+        gesture->engine = this;
+        gesture->name = gestureDef.at("name").get<std::string>();
+        gesture->count = gestureDef.value("count", 1U);
+        gesture->holdUsec = gestureDef.value("hold_ms", uint64_t(0)) * 1000;
+        auto instance = gestureDef.value("instance", size_t(0));
+
+        std::string type = gestureDef.at("type").get<std::string>();
+        if (type == "multi_press")
+        {
+            gesture->type = GestureType::multiPress;
+        }
+        else if (type == "hold")
+        {
+            gesture->type = GestureType::hold;
+        }
+        else if (type == "chord")
+        {
+            gesture->type = GestureType::chord;
+        }
+        else
+        {
+            lg2::error("{GESTURE}: unknown gesture type {TYPE}, skipping",
+                       "GESTURE", gesture->name, "TYPE", type);
+            continue;
+        }
+
+        std::vector<std::string> buttons;
+        if (gestureDef.contains("buttons"))
+        {
+            buttons = gestureDef["buttons"].get<std::vector<std::string>>();
+        }
+        else if (gestureDef.contains("button"))
+        {
+            buttons.emplace_back(gestureDef["button"].get<std::string>());
+        }
+
+        bool chord = (gesture->type == GestureType::chord);
+        if (buttons.empty() || (!chord && buttons.size() != 1) ||
+            (gesture->count == 0))
+        {
+            lg2::error("{GESTURE}: invalid gesture definition, skipping",
+                       "GESTURE", gesture->name);
+            continue;
+        }
+
+        for (const auto& button : buttons)
+        {
+            auto& track = getTrack(button, instance);
+            gesture->buttons.push_back(&track);
+
+            if (gesture->type == GestureType::multiPress)
+            {
+                uint64_t windowUsec =
+                    gestureDef.value("window_ms", defaultClickWindowMs) * 1000;
+                track.clickWindowUsec = std::max(track.clickWindowUsec,
+                                                 windowUsec);
+                track.multiPress.push_back(gesture.get());
+                if (!track.clickTimer)
+                {
+                    track.clickTimer = createTimer(clickTimerHandler, &track);
+                }
+            }
+            else
+            {
+                track.holds.push_back(gesture.get());
+            }
+        }
+
+        if (gesture->type != GestureType::multiPress)
+        {
+            gesture->timer = createTimer(holdTimerHandler, gesture.get());
+        }
+
+        lg2::info("Registered gesture {GESTURE}", "GESTURE", gesture->name);
+        gestures.emplace_back(std::move(gesture));
+    }
+
+    if (!gestures.empty())
+    {
+        signalIface = std::make_unique<sdbusplus::server::interface_t>(
+            bus, GESTURE_DBUS_OBJECT_NAME, buttons_private::gestureIface,
+            gestureVtable, this);
+    }
+}
+
+GestureEngine::ButtonTrack& GestureEngine::getTrack(const std::string& button,
+                                                    size_t instance)
+{
+    auto& track = tracks[button][instance];
+    track.engine = this;
+    return track;
+}
+
+EventSourcePtr GestureEngine::createTimer(sd_event_time_handler_t handler,
+                                          void* data)
+{
+    sd_event_source* timer = nullptr;
+    int ret = sd_event_add_time(event.get(), &timer, CLOCK_MONOTONIC, 0, 0,
+                                handler, data);
+    if (ret < 0)
+    {
+        lg2::error("Failed to create gesture timer: {RET}", "RET", ret);
+        return nullptr;
+    }
+    sd_event_source_set_enabled(timer, SD_EVENT_OFF);
+    return EventSourcePtr{timer};
+}
+
+void GestureEngine::armTimer(sd_event_source* timer, uint64_t usec)
+{
+    if (timer == nullptr)
+    {
+        return;
+    }
+    sd_event_source_set_time(timer, usec);
+    sd_event_source_set_enabled(timer, SD_EVENT_ONESHOT);
+}
+
+void GestureEngine::emitGesture(const Gesture& gesture, uint64_t usec)
+{
+    lg2::info("Gesture recognized : {GESTURE}", "GESTURE", gesture.name);
+    try
+    {
+        auto msg = bus.new_signal(GESTURE_DBUS_OBJECT_NAME,
+                                  buttons_private::gestureIface, "Recognized");
+        msg.append(gesture.name, usec);
+        msg.signal_send();
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        lg2::error("Failed to emit gesture {GESTURE}: {ERROR}", "GESTURE",
+                   gesture.name, "ERROR", e);
+    }
+}
+
+void GestureEngine::handleEdge(const EdgeEvent& edge)
+{
+    auto button = tracks.find(edge.button);
+    if (button == tracks.end())
+    {
+        return;
+    }
+    auto it = button->second.find(edge.instance);
+    if (it == button->second.end())
+    {
+        return;
+    }
+    auto& track = it->second;
+
+    // the timers which ran out by the time of the edge go first, a fast
+    // trace replay stamps its edges ahead of the loop clock
+    for (auto* gesture : track.holds)
+    {
+        runTimerIfDue(gesture->timer.get(), edge.timestamp, holdTimerHandler,
+                      gesture);
+    }
+    runTimerIfDue(track.clickTimer.get(), edge.timestamp, clickTimerHandler,
+                  &track);
+
+    bool pressed = (edge.state == GpioState::assert);
+    if (pressed == track.asserted)
+    {
+        return;
+    }
+    track.asserted = pressed;
+
+    if (pressed)
+    {
+        if (!track.multiPress.empty())
+        {
+            sd_event_source_set_enabled(track.clickTimer.get(), SD_EVENT_OFF);
+            track.clicks++;
+        }
+
+        for (auto* gesture : track.holds)
+        {
+            bool allHeld = std::all_of(
+                gesture->buttons.begin(), gesture->buttons.end(),
+                [](const ButtonTrack* button) { return button->asserted; });
+            if (!allHeld)
+            {
+                continue;
+            }
+            if (gesture->holdUsec == 0)
+            {
+                holdTimerHandler(nullptr, edge.timestamp, gesture);
+            }
+            else
+            {
+                armTimer(gesture->timer.get(),
+                         edge.timestamp + gesture->holdUsec);
+            }
+        }
+        return;
+    }
+
+    for (auto* gesture : track.holds)
+    {
+        sd_event_source_set_enabled(gesture->timer.get(), SD_EVENT_OFF);
+    }
+
+    if (track.holdFired)
+    {
+        track.holdFired = false;
+        track.clicks = 0;
+        return;
+    }
+
+    if (track.multiPress.empty())
+    {
+        return;
+    }
+
+    // resolve at once if no multi press gesture can match more clicks
+    bool morePossible = std::any_of(
+        track.multiPress.begin(), track.multiPress.end(),
+        [&track](const Gesture* gesture) {
+        return gesture->count > track.clicks;
+    });
+    if (morePossible)
+    {
+        armTimer(track.clickTimer.get(),
+                 edge.timestamp + track.clickWindowUsec);
+    }
+    else
+    {
+        clickTimerHandler(nullptr, edge.timestamp, &track);
+    }
+}
+
+int GestureEngine::clickTimerHandler(sd_event_source* /* es */, uint64_t usec,
+                                     void* userdata)
+{
+    auto& track = *static_cast<ButtonTrack*>(userdata);
+
+    for (const auto* gesture : track.multiPress)
+    {
+        if (gesture->count == track.clicks)
+        {
+            track.engine->emitGesture(*gesture, usec);
+            break;
+        }
+    }
+    track.clicks = 0;
+    return 0;
+}
+
+int GestureEngine::holdTimerHandler(sd_event_source* /* es */, uint64_t usec,
+                                    void* userdata)
+{
+    auto& gesture = *static_cast<Gesture*>(userdata);
+
+    // the presses which are part of the hold are not clicks
+    for (auto* button : gesture.buttons)
+    {
+        button->holdFired = true;
+        button->clicks = 0;
+        if (button->clickTimer)
+        {
+            sd_event_source_set_enabled(button->clickTimer.get(),
+                                        SD_EVENT_OFF);
+        }
+    }
+    gesture.engine->emitGesture(gesture, usec);
+    return 0;
+}
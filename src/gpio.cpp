@@ -18,8 +18,14 @@
 
 #include "gpio.hpp"
 
+#include "edge_decoder.hpp"
+#include "gpio_backend.hpp"
+#include "log_limiter.hpp"
+#include "probes.hpp"
+
 #include <error.h>
 #include <fcntl.h>
+#include <sys/epoll.h>
 #include <unistd.h>
 
 #include <gpioplus/utility/aspeed.hpp>
@@ -28,67 +34,52 @@
 
 #include <filesystem>
 #include <fstream>
+#include <system_error>
 
 const std::string gpioDev = "/sys/class/gpio";
 namespace fs = std::filesystem;
-std::unordered_map<GpioPolarity, GPIOBufferValue> GpioValueMap = {
-    {GpioPolarity::activeLow, {'0', '1'}},
-    {GpioPolarity::activeHigh, {'1', '0'}}};
-
-void setGpioState(int fd, GpioPolarity polarity, GpioState state)
+void setGpioState(const gpioInfo& gpio, GpioState state)
 {
-    char writeBuffer;
-
-    if (state == GpioState::assert)
-    {
-        writeBuffer = GpioValueMap[polarity].assert;
-    }
-    else
+    int fd = gpio.fd;
+    bool high = (state == GpioState::assert) ==
+                (gpio.polarity == GpioPolarity::activeHigh);
+
+    BUTTONS_PROBE(set_gpio_state, fd, static_cast<int>(state));
+    auto result = getGpioBackend().write(fd, high);
+    constexpr auto writeError = "GPIO write error gpio-{NUM} : {ERRORNO}";
+    if ((result < 0) && LogLimiter::instance().allow(gpio.number, writeError))
     {
-        writeBuffer = GpioValueMap[polarity].deassert;
-    }
-
-    auto result = ::write(fd, &writeBuffer, sizeof(writeBuffer));
-    if (result < 0)
-    {
-        lg2::error("GPIO write error {GPIOFD} : {ERRORNO}", "GPIOFD", fd,
-                   "ERRORNO", errno);
+        lg2::error(writeError, "NUM", gpio.number, "ERRORNO", -result);
     }
+    BUTTONS_PROBE(set_gpio_state_done, fd, static_cast<int>(result));
     return;
 }
-GpioState getGpioState(int fd, GpioPolarity polarity)
+GpioState getGpioState(const gpioInfo& gpio)
 {
-    int result = -1;
-    char readBuffer = '0';
-
-    result = ::lseek(fd, 0, SEEK_SET);
-
+    int fd = gpio.fd;
+    GpioEdge edge{};
+    GpioState gpioState = GpioState::invalid;
+
+    BUTTONS_PROBE(get_gpio_state, fd);
+    ProbeExit probeExit{[&]() {
+        BUTTONS_PROBE(get_gpio_state_done, fd, static_cast<int>(gpioState));
+    }};
+    auto result = getGpioBackend().read(fd, edge);
     if (result < 0)
     {
-        lg2::error("GPIO lseek error {GPIOFD}: {ERROR}", "GPIOFD", fd, "ERROR",
-                   errno);
-        return GpioState::invalid;
-    }
-
-    result = ::read(fd, &readBuffer, sizeof(readBuffer));
-    if (result < 0)
-    {
-        lg2::error("GPIO read error {GPIOFD}: {ERRORNO}", "GPIOFD", fd,
-                   "ERRORNO", errno);
+        constexpr auto readError = "GPIO read error gpio-{NUM}: {ERRORNO}";
+        if (LogLimiter::instance().allow(gpio.number, readError))
+        {
+            lg2::error(readError, "NUM", gpio.number, "ERRORNO", -result);
+        }
         throw std::runtime_error("GPIO read failed");
     }
-    // read the gpio state for the io event received
-    GpioState gpioState = (readBuffer == GpioValueMap[polarity].assert)
-                              ? (GpioState::assert)
-                              : (GpioState::deassert);
+    gpioState = getGpioLevelDecoder(gpio.polarity)(edge.high);
     return gpioState;
 }
 void closeGpio(int fd)
 {
-    if (fd > 0)
-    {
-        ::close(fd);
-    }
+    getGpioBackend().close(fd);
 }
 
 uint32_t getGpioBase()
@@ -97,7 +88,9 @@ uint32_t getGpioBase()
     // with a value of GPIO_BASE_LABEL_NAME.  Then read
     // the base value from the 'base' file in that directory.
 #ifdef LOOKUP_GPIO_BASE
-    for (auto& f : fs::directory_iterator(gpioDev))
+    // there is no /sys/class/gpio without any gpio chip
+    std::error_code ec;
+    for (auto& f : fs::directory_iterator(gpioDev, ec))
     {
         std::string path{f.path()};
         if (path.find("gpiochip") == std::string::npos)
@@ -118,6 +111,14 @@ uint32_t getGpioBase()
         }
     }
 
+    // the simulated lines keep the numbers of the chip when there is one,
+    // as in a trace recorded on the system, and are numbered from 0 when
+    // the daemon runs without it, e.g. in the tests
+    if (getGpioBackend().simulated())
+    {
+        return 0;
+    }
+
     lg2::error("Could not find GPIO base");
     throw std::runtime_error("Could not find GPIO base!");
 #else
@@ -156,6 +157,11 @@ int configGroupGpio(buttonConfig& buttonIFConfig)
 }
 
 int configGpio(gpioInfo& gpioConfig)
+{
+    return getGpioBackend().open(gpioConfig);
+}
+
+int SysfsGpioBackend::open(gpioInfo& gpioConfig)
 {
     auto gpioNum = gpioConfig.number;
     auto gpioDirection = gpioConfig.direction;
@@ -231,14 +237,15 @@ int configGpio(gpioInfo& gpioConfig)
             return -1;
         }
     }
-    else if (gpioDirection == "in")
+    else if ((gpioDirection == "in") || gpioConfig.polled)
     {
+        // a polled line is an input without an edge interrupt
         devPath = gpioDev + "/gpio" + std::to_string(gpioNum) + "/direction";
 
         stream.open(devPath, std::fstream::out);
         try
         {
-            stream << gpioDirection;
+            stream << "in";
             stream.close();
         }
 
@@ -294,8 +301,13 @@ int configGpio(gpioInfo& gpioConfig)
 
     if (fd < 0)
     {
-        lg2::error("Open {PATH} error: {ERROR}", "PATH", devPath, "ERROR",
-                   errno);
+        // retried with a backoff while the line is failing
+        constexpr auto openError = "Open {PATH} error: {ERROR}";
+        int err = errno;
+        if (LogLimiter::instance().allow(gpioNum, openError))
+        {
+            lg2::error(openError, "PATH", devPath, "ERROR", err);
+        }
         return -1;
     }
 
@@ -303,3 +315,45 @@ int configGpio(gpioInfo& gpioConfig)
 
     return 0;
 }
+
+uint32_t SysfsGpioBackend::pollEvents() const
+{
+    return EPOLLPRI;
+}
+
+int SysfsGpioBackend::read(int fd, GpioEdge& edge)
+{
+    char buf = '0';
+
+    if (::lseek(fd, 0, SEEK_SET) < 0)
+    {
+        return -errno;
+    }
+    if (::read(fd, &buf, sizeof(buf)) < 0)
+    {
+        return -errno;
+    }
+
+    edge.high = (buf != '0');
+    edge.timestamp = getMonotonicUsec();
+    return 0;
+}
+
+int SysfsGpioBackend::write(int fd, bool high)
+{
+    char buf = high ? '1' : '0';
+
+    if (::write(fd, &buf, sizeof(buf)) < 0)
+    {
+        return -errno;
+    }
+    return 0;
+}
+
+void SysfsGpioBackend::close(int fd)
+{
+    if (fd > 0)
+    {
+        ::close(fd);
+    }
+}
@@ -0,0 +1,475 @@
+#include "config.h"
+
+#include "gpio_backend.hpp"
+
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+constexpr auto gpioConsumer = "phosphor-buttons";
+
+static std::unique_ptr<GpioBackend> gpioBackend;
+
+GpioBackend& getGpioBackend()
+{
+    if (!gpioBackend)
+    {
+        gpioBackend = std::make_unique<SysfsGpioBackend>();
+    }
+    return *gpioBackend;
+}
+
+bool setGpioBackend(const std::string& name)
+{
+    if (name == "sysfs")
+    {
+        gpioBackend = std::make_unique<SysfsGpioBackend>();
+    }
+    else if (name == "chardev")
+    {
+        gpioBackend = std::make_unique<ChardevGpioBackend>();
+    }
+    else if (name == "sim")
+    {
+        gpioBackend = std::make_unique<SimGpioBackend>();
+    }
+    else
+    {
+        return false;
+    }
+
+    lg2::info("Using the {BACKEND} gpio backend", "BACKEND", name);
+    return true;
+}
+
+uint64_t getMonotonicUsec()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (static_cast<uint64_t>(ts.tv_sec) * 1000000) + (ts.tv_nsec / 1000);
+}
+
+namespace
+{
+
+/**
+ * @brief opens the gpio chip with the given label
+ * @return nullptr if there is none
+ */
+std::unique_ptr<gpioplus::Chip> openChip(std::string_view label)
+{
+    for (const auto& entry : fs::directory_iterator("/dev"))
+    {
+        auto name = entry.path().filename().string();
+        if (!name.starts_with("gpiochip"))
+        {
+            continue;
+        }
+
+        try
+        {
+            auto chip = std::make_unique<gpioplus::Chip>(
+                std::stoul(name.substr(std::strlen("gpiochip"))));
+            if (chip->getChipInfo().label == label)
+            {
+                return chip;
+            }
+        }
+        catch (const std::exception&)
+        {
+            // not a chip, or one we cannot open
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+void GpioBackend::readLevels(std::span<LevelRead> reads)
+{
+    for (auto& level : reads)
+    {
+        GpioEdge edge{};
+        level.result = read(level.fd, edge);
+        level.high = edge.high;
+    }
+}
+
+int ChardevGpioBackend::open(gpioInfo& gpio)
+{
+    if (!chip)
+    {
+        chip = openChip(GPIO_BASE_LABEL_NAME);
+        if (!chip)
+        {
+            lg2::error("No gpio chip labeled {LABEL}", "LABEL",
+                       GPIO_BASE_LABEL_NAME);
+            return -1;
+        }
+    }
+
+    // the gpio numbers are global sysfs numbers, the chip wants offsets
+    uint32_t offset = gpio.number - getGpioBase();
+
+    Line line;
+    try
+    {
+        if (gpio.direction == "out")
+        {
+            // keep the current level, as the sysfs backend does
+            std::array<gpioplus::Handle::Line, 1> request{{{offset, 0}}};
+            try
+            {
+                gpioplus::Handle input{*chip, request, gpioplus::HandleFlags{},
+                                       gpioConsumer};
+                request[0].default_value = input.getValues()[0];
+            }
+            catch (const std::exception&)
+            {
+                // the line may not be readable as an input, drive it low
+            }
+
+            gpioplus::HandleFlags flags{};
+            flags.output = true;
+            line.handle = std::make_unique<gpioplus::Handle>(*chip, request,
+                                                             flags,
+                                                             gpioConsumer);
+        }
+        else if (gpio.polled)
+        {
+            int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (fd < 0)
+            {
+                return -1;
+            }
+
+            polledOffsets.push_back(offset);
+            if (requestPolled() < 0)
+            {
+                // leave the other polled lines as they were
+                polledOffsets.pop_back();
+                requestPolled();
+                ::close(fd);
+                return -1;
+            }
+
+            line.polled = true;
+            line.offset = offset;
+            gpio.fd = fd;
+            lines.emplace(fd, std::move(line));
+            return 0;
+        }
+        else
+        {
+            // a line handle cannot be polled, so the inputs are requested
+            // with edge events too
+            line.event = std::make_unique<gpioplus::Event>(
+                *chip, offset, gpioplus::HandleFlags{},
+                gpioplus::EventFlags{true, true}, gpioConsumer);
+            const auto& fd = line.event->getFd();
+            fd.setFlags(fd.getFlags() | O_NONBLOCK);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        lg2::error("Failed to request gpio-{NUM}: {ERROR}", "NUM",
+                   gpio.number, "ERROR", e);
+        return -1;
+    }
+
+    gpio.fd = line.event ? *line.event->getFd() : *line.handle->getFd();
+    lines.emplace(gpio.fd, std::move(line));
+    return 0;
+}
+
+uint32_t ChardevGpioBackend::pollEvents() const
+{
+    return EPOLLIN;
+}
+
+int ChardevGpioBackend::read(int fd, GpioEdge& edge)
+{
+    auto it = lines.find(fd);
+    if (it == lines.end())
+    {
+        return -EBADF;
+    }
+    auto& line = it->second;
+
+    try
+    {
+        if (line.event)
+        {
+            auto event = line.event->read();
+            if (event)
+            {
+                edge.high = (event->id == GPIOEVENT_EVENT_RISING_EDGE);
+                edge.timestamp = event->timestamp / 1000;
+                return 0;
+            }
+
+            // no pending edge, read the current level
+            edge.high = (line.event->getValue() != 0);
+        }
+        else if (line.polled)
+        {
+            int ret = readPolled();
+            if (ret < 0)
+            {
+                return ret;
+            }
+            edge.high = (polledValues[polledIndex(line)] != 0);
+        }
+        else
+        {
+            line.handle->getValues(values);
+            edge.high = (values[0] != 0);
+        }
+    }
+    catch (const std::system_error& e)
+    {
+        return -e.code().value();
+    }
+    edge.timestamp = getMonotonicUsec();
+    return 0;
+}
+
+void ChardevGpioBackend::readLevels(std::span<LevelRead> reads)
+{
+    // a single ioctl for all the polled lines
+    int polledResult = readPolled();
+
+    for (auto& level : reads)
+    {
+        auto it = lines.find(level.fd);
+        if ((it == lines.end()) || !it->second.polled)
+        {
+            GpioEdge edge{};
+            level.result = read(level.fd, edge);
+            level.high = edge.high;
+            continue;
+        }
+
+        level.result = polledResult;
+        level.high = (polledResult == 0) &&
+                     (polledValues[polledIndex(it->second)] != 0);
+    }
+}
+
+int ChardevGpioBackend::requestPolled()
+{
+    // the lines are still held by the previous handle until it is released
+    polledHandle.reset();
+    if (polledOffsets.empty())
+    {
+        return 0;
+    }
+
+    std::vector<gpioplus::Handle::Line> request;
+    for (auto offset : polledOffsets)
+    {
+        request.push_back({offset, 0});
+    }
+
+    try
+    {
+        polledHandle = std::make_unique<gpioplus::Handle>(
+            *chip, request, gpioplus::HandleFlags{}, gpioConsumer);
+    }
+    catch (const std::system_error& e)
+    {
+        lg2::error("Failed to request the polled gpio lines: {ERROR}",
+                   "ERROR", e);
+        return -e.code().value();
+    }
+    return 0;
+}
+
+int ChardevGpioBackend::readPolled()
+{
+    if (!polledHandle)
+    {
+        return -ENODEV;
+    }
+
+    try
+    {
+        polledHandle->getValues(polledValues);
+    }
+    catch (const std::system_error& e)
+    {
+        return -e.code().value();
+    }
+    return 0;
+}
+
+size_t ChardevGpioBackend::polledIndex(const Line& line) const
+{
+    return std::find(polledOffsets.begin(), polledOffsets.end(),
+                     line.offset) -
+           polledOffsets.begin();
+}
+
+int ChardevGpioBackend::write(int fd, bool high)
+{
+    auto it = lines.find(fd);
+    if ((it == lines.end()) || !it->second.handle)
+    {
+        return -EBADF;
+    }
+
+    try
+    {
+        values.assign(1, high ? 1 : 0);
+        it->second.handle->setValues(values);
+    }
+    catch (const std::system_error& e)
+    {
+        return -e.code().value();
+    }
+    return 0;
+}
+
+void ChardevGpioBackend::close(int fd)
+{
+    auto it = lines.find(fd);
+    if (it == lines.end())
+    {
+        return;
+    }
+
+    if (it->second.polled)
+    {
+        std::erase(polledOffsets, it->second.offset);
+        requestPolled();
+        ::close(fd);
+    }
+    lines.erase(it);
+}
+
+int SimGpioBackend::open(gpioInfo& gpio)
+{
+    int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    lines[fd].number = gpio.number;
+    gpio.fd = fd;
+
+    if (readErrors.contains(gpio.number))
+    {
+        uint64_t count = 1;
+        [[maybe_unused]] auto n = ::write(fd, &count, sizeof(count));
+    }
+    return 0;
+}
+
+uint32_t SimGpioBackend::pollEvents() const
+{
+    return EPOLLIN;
+}
+
+int SimGpioBackend::read(int fd, GpioEdge& edge)
+{
+    auto it = lines.find(fd);
+    if (it == lines.end())
+    {
+        return -EBADF;
+    }
+    auto& line = it->second;
+
+    // the fd is left readable, so the read is retried on each dispatch
+    auto error = readErrors.find(line.number);
+    if (error != readErrors.end())
+    {
+        return error->second;
+    }
+
+    uint64_t count = 0;
+    [[maybe_unused]] auto n = ::read(fd, &count, sizeof(count));
+
+    if (line.pending.empty())
+    {
+        edge = {line.high, getMonotonicUsec()};
+        return 0;
+    }
+
+    edge = line.pending.front();
+    line.pending.pop_front();
+    line.high = edge.high;
+
+    // keep the fd readable until all the queued edges are read
+    if (!line.pending.empty())
+    {
+        count = 1;
+        n = ::write(fd, &count, sizeof(count));
+    }
+    return 0;
+}
+
+int SimGpioBackend::write(int fd, bool high)
+{
+    auto it = lines.find(fd);
+    if (it == lines.end())
+    {
+        return -EBADF;
+    }
+    it->second.high = high;
+    return 0;
+}
+
+void SimGpioBackend::close(int fd)
+{
+    if (lines.erase(fd) > 0)
+    {
+        ::close(fd);
+    }
+}
+
+bool SimGpioBackend::inject(uint32_t number, const GpioEdge& edge)
+{
+    for (auto& [fd, line] : lines)
+    {
+        if (line.number == number)
+        {
+            line.pending.push_back(edge);
+            uint64_t count = 1;
+            return ::write(fd, &count, sizeof(count)) == sizeof(count);
+        }
+    }
+    return false;
+}
+
+void SimGpioBackend::failReads(uint32_t number, int error)
+{
+    if (error == 0)
+    {
+        readErrors.erase(number);
+        return;
+    }
+    readErrors[number] = error;
+
+    for (const auto& [fd, line] : lines)
+    {
+        if (line.number == number)
+        {
+            uint64_t count = 1;
+            [[maybe_unused]] auto n = ::write(fd, &count, sizeof(count));
+        }
+    }
+}
@@ -0,0 +1,154 @@
+#include "gpio_poller.hpp"
+
+#include "button_interface.hpp"
+#include "edge_trace.hpp"
+#include "gpio_backend.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <ctime>
+
+namespace
+{
+
+uint64_t getThreadCpuUsec()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (static_cast<uint64_t>(ts.tv_sec) * 1000000) + (ts.tv_nsec / 1000);
+}
+
+} // namespace
+
+int GpioPoller::add(EventPtr& event, ButtonIface* button, size_t index,
+                    const gpioInfo& gpio, bool high, int64_t priority)
+{
+    uint64_t now = 0;
+    sd_event_now(event.get(), CLOCK_MONOTONIC, &now);
+    if (!timer)
+    {
+        sd_event_source* source = nullptr;
+        int ret = sd_event_add_time(event.get(), &source, CLOCK_MONOTONIC,
+                                    now + pollFastUsec, 0, pollHandler, this);
+        if (ret < 0)
+        {
+            lg2::error("Failed to create the gpio poll timer: {RET}", "RET",
+                       ret);
+            return ret;
+        }
+        timer.reset(source);
+        lastReportUsec = now;
+    }
+
+    lines.push_back({button, index, gpio.fd, gpio.number, high, priority});
+    updatePriority();
+    interval = pollFastUsec;
+    schedule(now);
+    return 0;
+}
+
+void GpioPoller::remove(const ButtonIface* button, size_t index)
+{
+    std::erase_if(lines, [button, index](const PolledLine& line) {
+        return (line.button == button) && (line.index == index);
+    });
+    if (lines.empty() && timer)
+    {
+        sd_event_source_set_enabled(timer.get(), SD_EVENT_OFF);
+    }
+    updatePriority();
+}
+
+void GpioPoller::updatePriority()
+{
+    if (!timer || lines.empty())
+    {
+        return;
+    }
+
+    // the timer stands for the edge sources of all the polled lines, so it
+    // is dispatched as early as the most urgent of them
+    auto urgent = std::min_element(lines.begin(), lines.end(),
+                                   [](const auto& a, const auto& b) {
+                                       return a.priority < b.priority;
+                                   });
+    sd_event_source_set_priority(timer.get(), urgent->priority);
+}
+
+void GpioPoller::poll(uint64_t now)
+{
+    uint64_t start = getThreadCpuUsec();
+
+    // the lines are all read first, in one batch, feeding an edge to a
+    // button may add or remove lines
+    reads.clear();
+    for (const auto& line : lines)
+    {
+        reads.push_back({line.fd, false, 0});
+    }
+    getGpioBackend().readLevels(reads);
+    uint64_t readUsec = getMonotonicUsec();
+
+    changed.clear();
+    failed.clear();
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+        auto& line = lines[i];
+        if (reads[i].result < 0)
+        {
+            failed.push_back(line);
+        }
+        else if (reads[i].high != line.high)
+        {
+            line.high = reads[i].high;
+            changed.emplace_back(line, GpioEdge{line.high, readUsec});
+        }
+    }
+
+    for (const auto& [line, edge] : changed)
+    {
+        EdgeTrace::instance().record(line.number, edge);
+        line.button->feedEdge(line.index, edge);
+    }
+    for (const auto& line : failed)
+    {
+        line.button->failGpio(line.index);
+    }
+
+    // poll fast while the lines change, and back off once they settle
+    interval = changed.empty() ? std::min(interval * 2, pollSlowUsec)
+                               : pollFastUsec;
+
+    ticks++;
+    busyUsec += getThreadCpuUsec() - start;
+    if (now - lastReportUsec >= pollReportUsec)
+    {
+        lg2::info("Polled {LINES} gpio lines {TICKS} times in {PERIOD_US}us, "
+                  "using {CPU_US}us of CPU",
+                  "LINES", lines.size(), "TICKS", ticks, "PERIOD_US",
+                  now - lastReportUsec, "CPU_US", busyUsec);
+        ticks = 0;
+        busyUsec = 0;
+        lastReportUsec = now;
+    }
+}
+
+void GpioPoller::schedule(uint64_t now)
+{
+    if (lines.empty())
+    {
+        return;
+    }
+    sd_event_source_set_time(timer.get(), now + interval);
+    sd_event_source_set_enabled(timer.get(), SD_EVENT_ONESHOT);
+}
+
+int GpioPoller::pollHandler(sd_event_source* /* es */, uint64_t usec,
+                            void* userdata)
+{
+    auto* poller = static_cast<GpioPoller*>(userdata);
+    poller->poll(usec);
+    poller->schedule(usec);
+    return 0;
+}
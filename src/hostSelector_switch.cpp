@@ -5,9 +5,6 @@
 
 #include <phosphor-logging/lg2.hpp>
 
-// add the button iface class to registry
-static ButtonIFRegister<HostSelector> buttonRegister;
-
 size_t HostSelector::getMappedHSConfig(size_t hsPosition)
 {
     size_t adjustedPosition = INVALID_INDEX; // set bmc as default value
@@ -39,29 +36,18 @@ size_t HostSelector::getGpioIndex(int fd)
 }
 void HostSelector::setInitialHostSelectorValue()
 {
-    char buf;
     for (size_t index = 0; index < gpioLineCount; index++)
     {
-        auto result = ::lseek(config.gpios[index].fd, 0, SEEK_SET);
-
-        if (result < 0)
-        {
-            lg2::error("{TYPE}: Gpio fd lseek error: {ERROR}", "TYPE",
-                       getFormFactorType(), "ERROR", errno);
-            throw sdbusplus::xyz::openbmc_project::Chassis::Common::Error::
-                IOError();
-        }
-
-        result = ::read(config.gpios[index].fd, &buf, sizeof(buf));
+        GpioEdge edge{};
+        int result = getGpioBackend().read(config.gpios[index].fd, edge);
         if (result < 0)
         {
             lg2::error("{TYPE}: Gpio fd read error: {ERROR}", "TYPE",
-                       getFormFactorType(), "ERROR", errno);
+                       getFormFactorType(), "ERROR", -result);
             throw sdbusplus::xyz::openbmc_project::Chassis::Common::Error::
                 IOError();
         }
-        GpioState gpioState = (buf == '0') ? (GpioState::deassert)
-                                           : (GpioState::assert);
+        GpioState gpioState = decoders[index](edge.high);
         setHostSelectorValue(config.gpios[index].fd, gpioState);
         size_t hsPosMapped = getMappedHSConfig(hostSelectorPosition);
         if (hsPosMapped != INVALID_INDEX)
@@ -98,32 +84,13 @@ void HostSelector::setHostSelectorValue(int fd, GpioState state)
 void HostSelector::handleEvent(sd_event_source* /* es */, int fd,
                                uint32_t /* revents */)
 {
-    int n = -1;
-    char buf = '0';
-
-    n = ::lseek(fd, 0, SEEK_SET);
-
-    if (n < 0)
+    auto edge = readEdge(fd);
+    if (!edge)
     {
-        lg2::error("{TYPE}: Gpio fd lseek error: {ERROR}", "TYPE",
-                   getFormFactorType(), "ERROR", errno);
         return;
     }
 
-    n = ::read(fd, &buf, sizeof(buf));
-    if (n < 0)
-    {
-        lg2::error("{TYPE}: Gpio fd read error: {ERROR}", "TYPE",
-                   getFormFactorType(), "ERROR", errno);
-        throw sdbusplus::xyz::openbmc_project::Chassis::Common::Error::
-            IOError();
-    }
-
-    // read the gpio state for the io event received
-    GpioState gpioState = (buf == '0') ? (GpioState::deassert)
-                                       : (GpioState::assert);
-
-    setHostSelectorValue(fd, gpioState);
+    setHostSelectorValue(fd, edge->state);
 
     size_t hsPosMapped = getMappedHSConfig(hostSelectorPosition);
 
@@ -132,3 +99,9 @@ void HostSelector::handleEvent(sd_event_source* /* es */, int fd,
         position(hsPosMapped);
     }
 }
+
+void HostSelector::gpioRecovered(size_t index)
+{
+    // edges may have been missed while the line was down, re-read it
+    handleEvent(nullptr, config.gpios[index].fd, 0);
+}
@@ -16,9 +16,6 @@
 
 #include "id_button.hpp"
 
-// add the button iface class to registry
-static ButtonIFRegister<IDButton> buttonRegister;
-
 void IDButton::simPress()
 {
     pressed();
@@ -27,36 +24,21 @@ void IDButton::simPress()
 void IDButton::handleEvent(sd_event_source* /* es */, int fd,
                            uint32_t /* revents */)
 {
-    int n = -1;
-    char buf = '0';
-    n = ::lseek(fd, 0, SEEK_SET);
-
-    if (n < 0)
-    {
-        phosphor::logging::log<phosphor::logging::level::ERR>(
-            (getFormFactorType() + " : lseek error!").c_str());
-        return;
-    }
-
-    n = ::read(fd, &buf, sizeof(buf));
-    if (n < 0)
+    auto edge = readEdge(fd);
+    if (!edge)
     {
-        phosphor::logging::log<phosphor::logging::level::ERR>(
-            (getFormFactorType() + " : read error!").c_str());
         return;
     }
 
-    if (buf == '0')
+    if (edge->state == GpioState::assert)
     {
-        phosphor::logging::log<phosphor::logging::level::DEBUG>(
-            (getFormFactorType() + " : pressed").c_str());
+        lg2::debug("{TYPE}: pressed", "TYPE", config.formFactorName);
         // emit pressed signal
         pressed();
     }
     else
     {
-        phosphor::logging::log<phosphor::logging::level::DEBUG>(
-            (getFormFactorType() + " : released").c_str());
+        lg2::debug("{TYPE}: released", "TYPE", config.formFactorName);
         // released
         released();
     }
@@ -14,21 +14,129 @@
 // limitations under the License.
 */
 
+#include "config.h"
+
 #include "button_factory.hpp"
+#include "edge_injector.hpp"
+#include "edge_journal.hpp"
+#include "edge_socket.hpp"
+#include "edge_trace.hpp"
+#include "gesture.hpp"
 #include "gpio.hpp"
+#include "gpio_backend.hpp"
+#include "log_limiter.hpp"
+#include "multi_call.hpp"
+#include "realtime.hpp"
+#include "sim_control.hpp"
+#include "startup_stats.hpp"
+#include "state_page.hpp"
+
+#include <getopt.h>
+#include <sched.h>
 
 #include <nlohmann/json.hpp>
 #include <phosphor-logging/elog-errors.hpp>
 #include <phosphor-logging/lg2.hpp>
 
 #include <fstream>
+#include <string>
 static constexpr auto gpioDefFile = "/etc/default/obmc/gpio/gpio_defs.json";
 
 nlohmann::json gpioDefs;
 
-int main(void)
+static void printUsage(const char* name)
+{
+    lg2::error("Usage: {NAME} [-c|--config <gpio defs file>] "
+               "[-p|--rt-priority <1-{MAX_PRIO}>] "
+               "[-g|--gpio-backend <sysfs|chardev|sim>] "
+               "[-t|--trace <file>] [-r|--replay <file> [-f|--replay-fast]]"
+#if SIM_CONTROL_ENABLED
+               " [-s|--sim-socket <socket>]"
+#endif
+               ,
+               "NAME", name, "MAX_PRIO", sched_get_priority_max(SCHED_FIFO));
+}
+
+#if MULTI_CALL_ENABLED
+int buttonsMain(int argc, char** argv)
+#else
+int main(int argc, char** argv)
+#endif
 {
     int ret = 0;
+    std::string configFile{gpioDefFile};
+    int rtPriority = RT_PRIORITY;
+    std::string gpioBackend;
+    std::string traceFile;
+    std::string replayFile;
+    bool replayFast = false;
+    std::string simSocket;
+
+    static const option longOptions[] = {
+        {"config", required_argument, nullptr, 'c'},
+        {"rt-priority", required_argument, nullptr, 'p'},
+        {"gpio-backend", required_argument, nullptr, 'g'},
+        {"trace", required_argument, nullptr, 't'},
+        {"replay", required_argument, nullptr, 'r'},
+        {"replay-fast", no_argument, nullptr, 'f'},
+#if SIM_CONTROL_ENABLED
+        {"sim-socket", required_argument, nullptr, 's'},
+#endif
+        {nullptr, 0, nullptr, 0}};
+#if SIM_CONTROL_ENABLED
+    constexpr auto shortOptions = "c:p:g:t:r:fs:";
+#else
+    constexpr auto shortOptions = "c:p:g:t:r:f";
+#endif
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, shortOptions, longOptions,
+                              nullptr)) != -1)
+    {
+        switch (opt)
+        {
+            case 'c':
+                configFile = optarg;
+                break;
+            case 'p':
+                try
+                {
+                    rtPriority = std::stoi(optarg);
+                }
+                catch (const std::exception&)
+                {
+                    printUsage(argv[0]);
+                    return -1;
+                }
+                if ((rtPriority < 1) ||
+                    (rtPriority > sched_get_priority_max(SCHED_FIFO)))
+                {
+                    printUsage(argv[0]);
+                    return -1;
+                }
+                break;
+            case 'g':
+                gpioBackend = optarg;
+                break;
+            case 't':
+                traceFile = optarg;
+                break;
+            case 'r':
+                replayFile = optarg;
+                break;
+            case 'f':
+                replayFast = true;
+                break;
+#if SIM_CONTROL_ENABLED
+            case 's':
+                simSocket = optarg;
+                break;
+#endif
+            default:
+                printUsage(argv[0]);
+                return -1;
+        }
+    }
 
     lg2::info("Start Phosphor buttons service...");
 
@@ -47,12 +155,55 @@ int main(void)
         bus, "/xyz/openbmc_project/Chassis/Buttons"};
 
     bus.request_name("xyz.openbmc_project.Chassis.Buttons");
+
+    EdgeJournal::instance().installCrashHandler(EDGE_JOURNAL_FILE);
+    EdgeJournalDump journalDump{bus, EDGE_JOURNAL_DBUS_OBJECT_NAME};
     std::vector<std::unique_ptr<ButtonIface>> buttonInterfaces;
 
-    std::ifstream gpios{gpioDefFile};
+    std::ifstream gpios{configFile};
     auto gpioDefJson = nlohmann::json::parse(gpios, nullptr, true);
     gpioDefs = gpioDefJson["gpio_definitions"];
 
+    // the command line wins over the gpio defs, the lines are all opened
+    // through the backend selected here
+    if (gpioBackend.empty() && gpioDefJson.contains("gpio_backend"))
+    {
+        gpioBackend = gpioDefJson["gpio_backend"].get<std::string>();
+    }
+    // a trace is replayed on the simulated lines, which can also be driven
+    // from the sim control socket
+    if (!replayFile.empty() || !simSocket.empty())
+    {
+        gpioBackend = "sim";
+    }
+    if (!gpioBackend.empty() && !setGpioBackend(gpioBackend))
+    {
+        lg2::error("Unknown gpio backend {BACKEND}", "BACKEND", gpioBackend);
+        printUsage(argv[0]);
+        return -1;
+    }
+    if (!traceFile.empty())
+    {
+        EdgeTrace::instance().open(traceFile);
+    }
+
+    // D-Bus traffic is dispatched after all the gpio sources by default
+    int64_t busPriority = SD_EVENT_PRIORITY_NORMAL;
+    if (gpioDefJson.contains("bus_event_priority"))
+    {
+        busPriority = getEventPriority(
+            gpioDefJson["bus_event_priority"].get<std::string>(), busPriority);
+    }
+
+    // the page is fed before the buttons are created, so that it also
+    // gets their initial state
+    if (StatePage::instance().open(STATE_PAGE_FILE))
+    {
+        EdgeDispatcher::instance().addListener([](const EdgeEvent& edge) {
+            StatePage::instance().update(edge);
+        });
+    }
+
     // load gpio config from gpio defs json file and create button interface
     // objects based on the button form factor type
 
@@ -62,6 +213,12 @@ int main(void)
         buttonConfig buttonCfg;
         buttonCfg.formFactorName = formFactorName;
         buttonCfg.extraJsonInfo = gpioConfig;
+        if (gpioConfig.contains("event_priority"))
+        {
+            buttonCfg.eventPriority = getEventPriority(
+                gpioConfig["event_priority"].get<std::string>(),
+                eventPriorityNormal);
+        }
 
         /* The folloing code checks if the gpio config read
         from json file is single gpio config or group gpio config,
@@ -81,6 +238,7 @@ int main(void)
                 gpioCfg.polarity = (config["polarity"] == "active_high")
                                        ? GpioPolarity::activeHigh
                                        : GpioPolarity::activeLow;
+                gpioCfg.polled = config.value("poll", false);
                 buttonCfg.gpios.push_back(gpioCfg);
             }
         }
@@ -89,9 +247,15 @@ int main(void)
             gpioInfo gpioCfg;
             gpioCfg.number = getGpioNum(gpioConfig["pin"]);
             gpioCfg.direction = gpioConfig["direction"];
+            // the single gpio buttons have always been active low
+            gpioCfg.polarity =
+                (gpioConfig.value("polarity", "active_low") == "active_high")
+                    ? GpioPolarity::activeHigh
+                    : GpioPolarity::activeLow;
+            gpioCfg.polled = gpioConfig.value("poll", false);
             buttonCfg.gpios.push_back(gpioCfg);
         }
-        auto tempButtonIf = ButtonFactory::instance().createInstance(
+        auto tempButtonIf = ButtonFactory::createInstance(
             formFactorName, bus, eventP, buttonCfg);
         /* There are additional gpio configs present in some platforms
          that are not supported in phosphor-buttons.
@@ -103,9 +267,67 @@ int main(void)
         }
     }
 
+    std::unique_ptr<GestureEngine> gestureEngine;
+    if (gpioDefJson.contains("gestures"))
+    {
+        gestureEngine = std::make_unique<GestureEngine>(
+            bus, eventP, gpioDefJson["gestures"]);
+        EdgeDispatcher::instance().addListener(
+            [&gestureEngine](const EdgeEvent& edge) {
+            gestureEngine->handleEdge(edge);
+        });
+    }
+
+#if EDGE_SOCKET_ENABLED
+    EdgeSocket edgeSocket{eventP, EDGE_SOCKET_FILE};
+    EdgeDispatcher::instance().addListener(
+        [&edgeSocket](const EdgeEvent& edge) { edgeSocket.handleEdge(edge); });
+#endif
+
+#if EDGE_INJECTION_ENABLED
+    EdgeInjector edgeInjector{bus, EDGE_INJECTOR_DBUS_OBJECT_NAME,
+                              buttonInterfaces};
+#endif
+
+    std::unique_ptr<EdgeTraceReplay> replay;
+    if (!replayFile.empty())
+    {
+        replay = std::make_unique<EdgeTraceReplay>(
+            eventP, static_cast<SimGpioBackend&>(getGpioBackend()), replayFile,
+            !replayFast);
+        if (!replay->start())
+        {
+            return -1;
+        }
+    }
+
+#if SIM_CONTROL_ENABLED
+    std::unique_ptr<SimControlSocket> simControl;
+    if (!simSocket.empty())
+    {
+        simControl = std::make_unique<SimControlSocket>(
+            eventP, static_cast<SimGpioBackend&>(getGpioBackend()), simSocket);
+        if (!simControl->enabled())
+        {
+            return -1;
+        }
+    }
+#endif
+
     try
     {
-        bus.attach_event(eventP.get(), SD_EVENT_PRIORITY_NORMAL);
+        bus.attach_event(eventP.get(), busPriority);
+        LogLimiter::instance().attach(eventP);
+
+        // all the gpio and D-Bus setup above runs under the default
+        // scheduler, only the event loop itself is promoted, within its CPU
+        // budget.
+        if (rtPriority > 0)
+        {
+            RealtimeMode::instance().enable(eventP, rtPriority);
+        }
+
+        logStartup("buttons");
         ret = sd_event_loop(eventP.get());
         if (ret < 0)
         {
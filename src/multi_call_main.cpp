@@ -0,0 +1,62 @@
+#include "multi_call.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <string_view>
+
+namespace
+{
+
+struct Applet
+{
+    std::string_view name;
+    int (*main)(int argc, char** argv);
+};
+
+constexpr Applet applets[] = {
+    {"buttons", buttonsMain},
+    {"button-handler", buttonHandlerMain},
+};
+
+const Applet* findApplet(std::string_view name)
+{
+    // argv[0] may be a path, as in the ExecStart of the services
+    auto slash = name.rfind('/');
+    if (slash != std::string_view::npos)
+    {
+        name.remove_prefix(slash + 1);
+    }
+
+    for (const auto& applet : applets)
+    {
+        if (applet.name == name)
+        {
+            return &applet;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    // called through one of the links named after the daemons
+    if (const auto* applet = findApplet(argv[0]))
+    {
+        return applet->main(argc, argv);
+    }
+
+    // or with the daemon as the first argument, which then becomes argv[0]
+    if (argc > 1)
+    {
+        if (const auto* applet = findApplet(argv[1]))
+        {
+            return applet->main(argc - 1, argv + 1);
+        }
+    }
+
+    lg2::error("Usage: {NAME} <buttons|button-handler> [arguments]", "NAME",
+               argv[0]);
+    return -1;
+}
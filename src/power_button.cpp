@@ -16,9 +16,6 @@
 
 #include "power_button.hpp"
 
-// add the button iface class to registry
-static ButtonIFRegister<PowerButton> buttonRegister;
-
 void PowerButton::simPress()
 {
     pressed();
@@ -29,45 +26,40 @@ void PowerButton::simLongPress()
     pressedLong();
 }
 
-void PowerButton::updatePressedTime()
+void PowerButton::updatePressedTime(uint64_t usec)
 {
-    pressedTime = std::chrono::steady_clock::now();
+    pressedTime = usec;
 }
 
-auto PowerButton::getPressTime() const
+uint64_t PowerButton::getPressTime() const
 {
     return pressedTime;
 }
 
+void PowerButton::longPressed()
+{
+    phosphor::logging::log<phosphor::logging::level::DEBUG>(
+        "POWER_BUTTON: long pressed");
+    // emit long pressed signal while the button is still held
+    pressedLong();
+}
+
 void PowerButton::handleEvent(sd_event_source* /* es */, int fd,
                               uint32_t /* revents */)
 {
-    int n = -1;
-    char buf = '0';
-
-    n = ::lseek(fd, 0, SEEK_SET);
-
-    if (n < 0)
-    {
-        phosphor::logging::log<phosphor::logging::level::ERR>(
-            "POWER_BUTTON: lseek error!");
-        return;
-    }
-
-    n = ::read(fd, &buf, sizeof(buf));
-    if (n < 0)
+    auto edge = readEdge(fd);
+    if (!edge)
     {
-        phosphor::logging::log<phosphor::logging::level::ERR>(
-            "POWER_BUTTON: read error!");
         return;
     }
 
-    if (buf == '0')
+    if (edge->state == GpioState::assert)
     {
         phosphor::logging::log<phosphor::logging::level::DEBUG>(
             "POWER_BUTTON: pressed");
 
-        updatePressedTime();
+        updatePressedTime(edge->timestamp);
+        startLongPressTimer(edge->timestamp);
         // emit pressed signal
         pressed();
     }
@@ -76,10 +68,13 @@ void PowerButton::handleEvent(sd_event_source* /* es */, int fd,
         phosphor::logging::log<phosphor::logging::level::DEBUG>(
             "POWER_BUTTON: released");
 
-        auto now = std::chrono::steady_clock::now();
-        auto d = std::chrono::duration_cast<std::chrono::microseconds>(
-            now - getPressTime());
+        stopLongPressTimer();
+        // the time between the edges, which is also right for injected and
+        // replayed edges
+        uint64_t d = (edge->timestamp > getPressTime())
+                         ? edge->timestamp - getPressTime()
+                         : 0;
         // released
-        released(d.count());
+        released(d);
     }
 }
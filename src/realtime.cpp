@@ -0,0 +1,215 @@
+#include "realtime.hpp"
+
+#include "log_limiter.hpp"
+
+#include <malloc.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+volatile sig_atomic_t RealtimeMode::burstDemoted = 0;
+
+static void prefaultStack()
+{
+    volatile char stack[rtStackPrefaultSize];
+    const auto pageSize = ::sysconf(_SC_PAGESIZE);
+
+    for (size_t offset = 0; offset < sizeof(stack);
+         offset += static_cast<size_t>(pageSize))
+    {
+        stack[offset] = 0;
+    }
+}
+
+static void prefaultHeap()
+{
+    // keep freed memory in the arena instead of returning it to the kernel
+    // and serve large allocations from the (locked) arena as well.
+    ::mallopt(M_TRIM_THRESHOLD, -1);
+    ::mallopt(M_MMAP_MAX, 0);
+
+    auto* buf = static_cast<char*>(std::malloc(rtHeapPrefaultSize));
+    if (buf == nullptr)
+    {
+        return;
+    }
+    std::memset(buf, 0, rtHeapPrefaultSize);
+    std::free(buf);
+}
+
+static uint64_t getThreadCpuUsec()
+{
+    timespec ts{};
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+int RealtimeMode::enable(EventPtr& event, int rtPriority)
+{
+    if (::mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+    {
+        int err = errno;
+        lg2::error("Failed to lock process memory: {ERRNO}", "ERRNO", err);
+        return -err;
+    }
+
+    prefaultHeap();
+    prefaultStack();
+
+    // the burst limit is armed first, so the loop is never at the
+    // real-time priority without it
+    struct sigaction action{};
+    action.sa_handler = burstHandler;
+    ::sigemptyset(&action.sa_mask);
+    ::sigaction(SIGXCPU, &action, &oldAction);
+
+    // SIGXCPU comes at the soft limit, SIGKILL at the hard one: a hard
+    // limit too close to the burst limit would kill the daemon before the
+    // handler demotes it, the budget timer alone bounds the loop then
+    ::getrlimit(RLIMIT_RTTIME, &oldLimit);
+    if ((oldLimit.rlim_max == RLIM_INFINITY) ||
+        (oldLimit.rlim_max >= rtBurstHardLimitUsec))
+    {
+        rlimit limit{rtBurstLimitUsec, oldLimit.rlim_max};
+        if (::setrlimit(RLIMIT_RTTIME, &limit) < 0)
+        {
+            int err = errno;
+            lg2::error("Failed to set the real-time CPU limit: {ERRNO}",
+                       "ERRNO", err);
+            rollback();
+            return -err;
+        }
+    }
+    else
+    {
+        lg2::warning("Real-time CPU hard limit of {LIMIT_US}us leaves no room "
+                     "for the burst limit, it is not set",
+                     "LIMIT_US", oldLimit.rlim_max);
+    }
+
+    sd_event_source* source = nullptr;
+    int ret = sd_event_add_time(event.get(), &source, CLOCK_MONOTONIC, 0, 0,
+                                budgetHandler, this);
+    if (ret < 0)
+    {
+        lg2::error("Failed to add the real-time budget timer: {RET}", "RET",
+                   ret);
+        rollback();
+        return ret;
+    }
+    timer.reset(source);
+    sd_event_source_set_priority(source, rtBudgetPriority);
+
+    uint64_t now = 0;
+    sd_event_now(event.get(), CLOCK_MONOTONIC, &now);
+    sd_event_source_set_time(source, now + rtBudgetIntervalUsec);
+    sd_event_source_set_enabled(source, SD_EVENT_ONESHOT);
+
+    ret = setScheduler(SCHED_FIFO, rtPriority);
+    if (ret < 0)
+    {
+        lg2::error("Failed to set SCHED_FIFO priority {PRIO}: {ERRNO}", "PRIO",
+                   rtPriority, "ERRNO", -ret);
+        rollback();
+        return ret;
+    }
+    priority = rtPriority;
+    lastCpuUsec = getThreadCpuUsec();
+
+    lg2::info("Real-time latency mode enabled, priority {PRIO}, budget "
+              "{BUDGET_US}us per {INTERVAL_US}us",
+              "PRIO", priority, "BUDGET_US", rtBudgetUsec, "INTERVAL_US",
+              rtBudgetIntervalUsec);
+    return 0;
+}
+
+void RealtimeMode::rollback()
+{
+    timer.reset();
+    ::setrlimit(RLIMIT_RTTIME, &oldLimit);
+    ::sigaction(SIGXCPU, &oldAction, nullptr);
+    ::munlockall();
+}
+
+int RealtimeMode::setScheduler(int policy, int rtPriority)
+{
+    sched_param param{};
+    param.sched_priority = rtPriority;
+    if (::sched_setscheduler(0, policy, &param) < 0)
+    {
+        return -errno;
+    }
+    return 0;
+}
+
+void RealtimeMode::checkBudget(uint64_t now)
+{
+    uint64_t cpuUsec = getThreadCpuUsec();
+    uint64_t used = cpuUsec - lastCpuUsec;
+    lastCpuUsec = cpuUsec;
+
+    if (burstDemoted)
+    {
+        burstDemoted = 0;
+        demoted = true;
+        demotions++;
+        constexpr auto burstMsg = "Event loop ran {LIMIT_US}us without "
+                                  "blocking, demoted from the real-time "
+                                  "priority";
+        if (LogLimiter::instance().allow(this, burstMsg))
+        {
+            lg2::warning(burstMsg, "LIMIT_US", rtBurstLimitUsec);
+        }
+    }
+    else if (!demoted && (used > rtBudgetUsec))
+    {
+        setScheduler(SCHED_OTHER, 0);
+        demoted = true;
+        demotions++;
+        constexpr auto budgetMsg = "Event loop used {USED_US}us of CPU in "
+                                   "{INTERVAL_US}us, demoted from the "
+                                   "real-time priority";
+        if (LogLimiter::instance().allow(this, budgetMsg))
+        {
+            lg2::warning(budgetMsg, "USED_US", used, "INTERVAL_US",
+                         rtBudgetIntervalUsec);
+        }
+    }
+    else if (demoted && (used <= rtBudgetUsec))
+    {
+        if (setScheduler(SCHED_FIFO, priority) == 0)
+        {
+            demoted = false;
+            lg2::info("Event loop back within its CPU budget, promoted to "
+                      "priority {PRIO}",
+                      "PRIO", priority);
+        }
+    }
+
+    sd_event_source_set_time(timer.get(), now + rtBudgetIntervalUsec);
+    sd_event_source_set_enabled(timer.get(), SD_EVENT_ONESHOT);
+}
+
+int RealtimeMode::budgetHandler(sd_event_source* /* es */, uint64_t usec,
+                                void* userdata)
+{
+    static_cast<RealtimeMode*>(userdata)->checkBudget(usec);
+    return 0;
+}
+
+void RealtimeMode::burstHandler(int /* signal */)
+{
+    // the loop is demoted right away, the budget timer logs it. Only
+    // async-signal-safe calls here.
+    sched_param param{};
+    ::sched_setscheduler(0, SCHED_OTHER, &param);
+    burstDemoted = 1;
+}
@@ -18,9 +18,6 @@
 
 #include "xyz/openbmc_project/Chassis/Buttons/Reset/server.hpp"
 
-// add the button iface class to registry
-static ButtonIFRegister<ResetButton> buttonRegister;
-
 void ResetButton::simPress()
 {
     pressed();
@@ -29,28 +26,13 @@ void ResetButton::simPress()
 void ResetButton::handleEvent(sd_event_source* /* es */, int fd,
                               uint32_t /* revents */)
 {
-    int n = -1;
-    char buf = '0';
-
-    n = ::lseek(fd, 0, SEEK_SET);
-
-    if (n < 0)
-    {
-        phosphor::logging::log<phosphor::logging::level::ERR>(
-            "RESET_BUTTON: lseek error!");
-
-        return;
-    }
-
-    n = ::read(fd, &buf, sizeof(buf));
-    if (n < 0)
+    auto edge = readEdge(fd);
+    if (!edge)
     {
-        phosphor::logging::log<phosphor::logging::level::ERR>(
-            "RESET_BUTTON: read error!");
         return;
     }
 
-    if (buf == '0')
+    if (edge->state == GpioState::assert)
     {
         phosphor::logging::log<phosphor::logging::level::DEBUG>(
             "RESET_BUTTON: pressed");
@@ -7,8 +7,6 @@
 
 #include <phosphor-logging/lg2.hpp>
 namespace sdbusRule = sdbusplus::bus::match::rules;
-// add the button iface class to registry
-static ButtonIFRegister<SerialUartMux> buttonRegister;
 namespace HostSelectorServerObj =
     sdbusplus::xyz::openbmc_project::Chassis::Buttons::server;
 namespace HostSelectorClientObj =
@@ -41,8 +39,7 @@ void SerialUartMux::init()
 // check the debug card present pin
 bool SerialUartMux::isOCPDebugCardPresent()
 {
-    auto gpioState = getGpioState(debugCardPresentGpio.fd,
-                                  debugCardPresentGpio.polarity);
+    auto gpioState = getGpioState(debugCardPresentGpio);
     return (gpioState == GpioState::assert);
 }
 // set the serial uart MUX to select the console w.r.t host selector position
@@ -75,7 +72,7 @@ void SerialUartMux::configSerialConsoleMux(size_t position)
                             ? GpioState::assert
                             : GpioState::deassert;
         }
-        setGpioState(gpioConfig.fd, gpioConfig.polarity, gpioState);
+        setGpioState(gpioConfig, gpioState);
     }
 }
 
@@ -0,0 +1,133 @@
+#include "sim_control.hpp"
+
+#include "log_limiter.hpp"
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+
+SimControlSocket::SimControlSocket(EventPtr& event, SimGpioBackend& backend,
+                                   const std::string& path) :
+    backend(backend), path(path)
+{
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+        lg2::error("Sim control socket path {PATH} is too long", "PATH", path);
+        return;
+    }
+    std::strcpy(addr.sun_path, path.c_str());
+
+    fd = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        lg2::error("Failed to create the sim control socket: {ERROR}", "ERROR",
+                   errno);
+        return;
+    }
+
+    // left over by a previous run
+    ::unlink(path.c_str());
+
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+    {
+        lg2::error("Failed to bind the sim control socket {PATH}: {ERROR}",
+                   "PATH", path, "ERROR", errno);
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+
+    sd_event_source* ioSource = nullptr;
+    int ret = sd_event_add_io(event.get(), &ioSource, fd, EPOLLIN,
+                              readHandler, this);
+    if (ret < 0)
+    {
+        lg2::error("Failed to add the sim control socket to the event loop: "
+                   "{RET}",
+                   "RET", ret);
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+    source.reset(ioSource);
+    sd_event_source_set_priority(ioSource, simControlPriority);
+
+    lg2::info("Driving the simulated gpio lines from {PATH}", "PATH", path);
+}
+
+SimControlSocket::~SimControlSocket()
+{
+    source.reset();
+    if (fd >= 0)
+    {
+        ::close(fd);
+        ::unlink(path.c_str());
+    }
+}
+
+void SimControlSocket::readEdges()
+{
+    std::array<SimEdgeRecord, simControlMaxBatch> records{};
+    ssize_t n = ::recv(fd, records.data(), sizeof(records), 0);
+    if (n < 0)
+    {
+        return;
+    }
+
+    constexpr auto malformed = "Malformed sim control datagram of {SIZE} bytes";
+    if ((n == 0) || (n % sizeof(SimEdgeRecord) != 0))
+    {
+        if (LogLimiter::instance().allow(this, malformed))
+        {
+            lg2::error(malformed, "SIZE", n);
+        }
+        return;
+    }
+
+    size_t count = n / sizeof(SimEdgeRecord);
+    uint64_t now = getMonotonicUsec();
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t timestamp = records[i].timestamp;
+        constexpr auto outOfRange = "Sim edge timestamp {TIMESTAMP} out of "
+                                    "range, dropping the datagram";
+        if ((timestamp > now) ||
+            ((timestamp != 0) && (now - timestamp > simControlMaxAgeUsec)))
+        {
+            if (LogLimiter::instance().allow(this, outOfRange))
+            {
+                lg2::error(outOfRange, "TIMESTAMP", timestamp);
+            }
+            return;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const auto& record = records[i];
+        GpioEdge edge{record.high != 0,
+                      (record.timestamp != 0) ? record.timestamp : now, true};
+        constexpr auto unknownLine = "No simulated gpio-{NUM}";
+        if (!backend.inject(record.number, edge) &&
+            LogLimiter::instance().allow(record.number, unknownLine))
+        {
+            lg2::error(unknownLine, "NUM", record.number);
+        }
+    }
+}
+
+int SimControlSocket::readHandler(sd_event_source* /* es */, int /* fd */,
+                                  uint32_t /* revents */, void* userdata)
+{
+    static_cast<SimControlSocket*>(userdata)->readEdges();
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include "state_page.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <cerrno>
+
+bool StatePage::open(const char* path)
+{
+    int fd = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        lg2::error("Failed to open the state page {PATH}: {ERROR}", "PATH",
+                   path, "ERROR", errno);
+        return false;
+    }
+
+    if (::ftruncate(fd, sizeof(StatePageLayout)) < 0)
+    {
+        lg2::error("Failed to size the state page {PATH}: {ERROR}", "PATH",
+                   path, "ERROR", errno);
+        ::close(fd);
+        return false;
+    }
+
+    void* addr = ::mmap(nullptr, sizeof(StatePageLayout),
+                        PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+    {
+        lg2::error("Failed to map the state page {PATH}: {ERROR}", "PATH",
+                   path, "ERROR", errno);
+        return false;
+    }
+    page = static_cast<StatePageLayout*>(addr);
+
+    // the file may be left over from a previous run which stopped in the
+    // middle of an update, the sequence carries on from an even value
+    uint32_t sequence = page->sequence.load(std::memory_order_relaxed);
+    page->sequence.store(sequence | 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memset(&page->data, 0, sizeof(page->data));
+    page->data.selectorPosition = statePagePositionUnknown;
+    page->magic = statePageMagic;
+    page->version = statePageVersion;
+    endWrite();
+
+    lg2::info("Publishing the button state in {PATH}", "PATH", path);
+    return true;
+}
+
+StatePage::~StatePage()
+{
+    if (page != nullptr)
+    {
+        ::munmap(page, sizeof(StatePageLayout));
+    }
+}
+
+StatePageButton* StatePage::getButton(std::string_view name,
+                                      size_t instance)
+{
+    name = name.substr(0, statePageNameSize - 1);
+
+    auto& data = page->data;
+    for (uint32_t index = 0; index < data.buttonCount; index++)
+    {
+        if ((name == data.buttons[index].name) &&
+            (instance == data.buttons[index].instance))
+        {
+            return &data.buttons[index];
+        }
+    }
+
+    if (data.buttonCount == statePageMaxButtons)
+    {
+        return nullptr;
+    }
+
+    auto& button = data.buttons[data.buttonCount++];
+    std::memcpy(button.name, name.data(), name.size());
+    button.name[name.size()] = '\0';
+    button.instance = static_cast<uint32_t>(instance);
+    return &button;
+}
+
+void StatePage::update(const EdgeEvent& edge)
+{
+    if (page == nullptr)
+    {
+        return;
+    }
+
+    beginWrite();
+    auto* button = getButton(edge.button, edge.instance);
+    if ((button != nullptr) && (edge.line < 32))
+    {
+        uint32_t mask = 1U << edge.line;
+        if (edge.state == GpioState::assert)
+        {
+            button->level |= mask;
+            button->pressCount++;
+        }
+        else
+        {
+            button->level &= ~mask;
+        }
+        button->lastEdgeUsec = edge.timestamp;
+    }
+    endWrite();
+}
+
+void StatePage::setLevel(std::string_view name, size_t instance, size_t line,
+                         GpioState state)
+{
+    if (page == nullptr)
+    {
+        return;
+    }
+
+    beginWrite();
+    auto* button = getButton(name, instance);
+    if ((button != nullptr) && (line < 32))
+    {
+        uint32_t mask = 1U << line;
+        if (state == GpioState::assert)
+        {
+            button->level |= mask;
+        }
+        else
+        {
+            button->level &= ~mask;
+        }
+    }
+    endWrite();
+}
+
+void StatePage::setSelectorPosition(size_t position)
+{
+    if (page == nullptr)
+    {
+        return;
+    }
+
+    beginWrite();
+    page->data.selectorPosition = static_cast<int64_t>(position);
+    endWrite();
+}
@@ -0,0 +1,544 @@
+#include "config.h"
+
+#include "fake_services.hpp"
+#include "private_bus.hpp"
+#include "sim_control.hpp"
+
+#include <getopt.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <nlohmann/json.hpp>
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/bus/match.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * End to end latency benchmark of the buttons and button-handler daemons.
+ *
+ * Both daemons run against a private dbus-daemon, with the buttons daemon on
+ * simulated gpio lines driven through its sim control socket and the
+ * handler talking to the fake mapper and state managers of FakeServices.
+ * A power button is pressed and released iterations times, measuring:
+ *
+ *  - edge_to_signal_us: from the edge to the Pressed or Released signal
+ *  - signal_to_set_us: from the Released signal to the RequestedHostTransition
+ *    Set received by the fake host state manager
+ *  - press_to_action_us: from the release edge, which the default policy acts
+ *    on, to that Set
+ *
+ * Then a storm of edges is sent as fast as the socket takes them, to measure
+ * the signals per second the buttons daemon sustains. The results are
+ * printed as JSON.
+ *
+ * With --cpu-hog, the buttons daemon shares its CPU with busy looping
+ * processes, as on a BMC flashing its firmware, and --rt-priority runs it in
+ * the real-time latency mode to compare.
+ */
+
+namespace fs = std::filesystem;
+namespace sdbusRule = sdbusplus::bus::match::rules;
+using namespace phosphor::button::test;
+
+constexpr auto powerButtonIface = "xyz.openbmc_project.Chassis.Buttons.Power";
+constexpr auto transitionProperty = "RequestedHostTransition";
+
+// the power button of the gpio defs, on gpio 0
+constexpr auto powerButtonPin = "A0";
+constexpr uint32_t powerButtonGpio = 0;
+
+// the CPU the hogs and the buttons daemon are pinned to
+constexpr int hogCpu = 0;
+
+constexpr auto eventTimeout = std::chrono::seconds(2);
+constexpr auto startTimeout = std::chrono::seconds(10);
+// the storm is over once no signal arrived for this long
+constexpr auto stormQuietTime = std::chrono::milliseconds(500);
+
+struct Options
+{
+    std::string buttons;
+    std::string handler;
+    std::string output;
+    size_t iterations = 200;
+    size_t stormEdges = 20000;
+    size_t cpuHogs = 0;
+    int rtPriority = 0;
+};
+
+static void pinToHogCpu()
+{
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(hogCpu, &cpus);
+    ::sched_setaffinity(0, sizeof(cpus), &cpus);
+}
+
+/**
+ * @brief a daemon started for the benchmark, stopped with it
+ */
+class Daemon
+{
+  public:
+    Daemon(const Daemon&) = delete;
+    Daemon& operator=(const Daemon&) = delete;
+    Daemon(Daemon&&) = delete;
+    Daemon& operator=(Daemon&&) = delete;
+
+    /**
+     * @param[in] exe - the daemon, or the multi-call phosphor-buttons binary
+     * @param[in] applet - daemon name, passed first to phosphor-buttons
+     * @param[in] args - daemon arguments
+     * @param[in] pinned - runs the daemon on the CPU of the hogs
+     */
+    Daemon(const std::string& exe, const std::string& applet,
+           const std::vector<std::string>& args, bool pinned = false)
+    {
+        std::vector<std::string> argv{exe};
+        if (fs::path(exe).filename() == "phosphor-buttons")
+        {
+            argv.push_back(applet);
+        }
+        argv.insert(argv.end(), args.begin(), args.end());
+
+        pid = ::fork();
+        if (pid == 0)
+        {
+            // stdout is for the results
+            ::dup2(STDERR_FILENO, STDOUT_FILENO);
+            if (pinned)
+            {
+                pinToHogCpu();
+            }
+            std::vector<char*> cargv;
+            for (auto& arg : argv)
+            {
+                cargv.push_back(arg.data());
+            }
+            cargv.push_back(nullptr);
+            ::execv(cargv[0], cargv.data());
+            ::_exit(127);
+        }
+        if (pid < 0)
+        {
+            throw std::runtime_error("Failed to start " + exe);
+        }
+    }
+
+    ~Daemon()
+    {
+        if (pid > 0)
+        {
+            ::kill(pid, SIGTERM);
+            ::waitpid(pid, nullptr, 0);
+        }
+    }
+
+  private:
+    pid_t pid = -1;
+};
+
+/**
+ * @brief busy looping processes on the CPU of the buttons daemon
+ */
+class CpuHogs
+{
+  public:
+    CpuHogs(const CpuHogs&) = delete;
+    CpuHogs& operator=(const CpuHogs&) = delete;
+    CpuHogs(CpuHogs&&) = delete;
+    CpuHogs& operator=(CpuHogs&&) = delete;
+
+    explicit CpuHogs(size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            pid_t pid = ::fork();
+            if (pid == 0)
+            {
+                pinToHogCpu();
+                while (true)
+                {}
+            }
+            if (pid < 0)
+            {
+                throw std::runtime_error("Failed to start a CPU hog");
+            }
+            pids.push_back(pid);
+        }
+    }
+
+    ~CpuHogs()
+    {
+        for (auto pid : pids)
+        {
+            ::kill(pid, SIGKILL);
+            ::waitpid(pid, nullptr, 0);
+        }
+    }
+
+  private:
+    std::vector<pid_t> pids;
+};
+
+/**
+ * @brief sends edges to the sim control socket of the buttons daemon
+ */
+class SimControl
+{
+  public:
+    SimControl(const SimControl&) = delete;
+    SimControl& operator=(const SimControl&) = delete;
+    SimControl(SimControl&&) = delete;
+    SimControl& operator=(SimControl&&) = delete;
+
+    explicit SimControl(const std::string& path)
+    {
+        fd = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Failed to create the sim socket");
+        }
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    }
+
+    ~SimControl()
+    {
+        ::close(fd);
+    }
+
+    bool send(const std::vector<SimEdgeRecord>& records)
+    {
+        return ::sendto(fd, records.data(),
+                        records.size() * sizeof(SimEdgeRecord), 0,
+                        reinterpret_cast<const sockaddr*>(&addr),
+                        sizeof(addr)) >= 0;
+    }
+
+  private:
+    int fd = -1;
+    sockaddr_un addr{};
+};
+
+struct Samples
+{
+    std::vector<uint64_t> values;
+
+    void add(uint64_t value)
+    {
+        values.push_back(value);
+    }
+
+    nlohmann::json toJson()
+    {
+        std::sort(values.begin(), values.end());
+        // nearest rank percentiles, exact over the samples
+        auto percentile = [this](double p) -> uint64_t {
+            if (values.empty())
+            {
+                return 0;
+            }
+            auto rank = static_cast<size_t>(std::ceil(p * values.size()));
+            return values[std::max<size_t>(rank, 1) - 1];
+        };
+        return {{"count", values.size()},
+                {"p50", percentile(0.5)},
+                {"p99", percentile(0.99)},
+                {"max", values.empty() ? 0 : values.back()}};
+    }
+};
+
+static void printUsage(const char* name)
+{
+    std::cerr << "Usage: " << name
+              << " --buttons <exe> --button-handler <exe> [--output <file>]"
+                 " [--iterations <n>] [--storm-edges <n>] [--cpu-hog <n>]"
+                 " [--rt-priority <1-99>]\n";
+}
+
+static bool parseOptions(int argc, char** argv, Options& options)
+{
+    static const option longOptions[] = {
+        {"buttons", required_argument, nullptr, 'b'},
+        {"button-handler", required_argument, nullptr, 'h'},
+        {"output", required_argument, nullptr, 'o'},
+        {"iterations", required_argument, nullptr, 'i'},
+        {"storm-edges", required_argument, nullptr, 's'},
+        {"cpu-hog", required_argument, nullptr, 'c'},
+        {"rt-priority", required_argument, nullptr, 'p'},
+        {nullptr, 0, nullptr, 0}};
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "b:h:o:i:s:c:p:", longOptions,
+                              nullptr)) != -1)
+    {
+        try
+        {
+            switch (opt)
+            {
+                case 'b':
+                    options.buttons = optarg;
+                    break;
+                case 'h':
+                    options.handler = optarg;
+                    break;
+                case 'o':
+                    options.output = optarg;
+                    break;
+                case 'i':
+                    options.iterations = std::stoul(optarg);
+                    break;
+                case 's':
+                    options.stormEdges = std::stoul(optarg);
+                    break;
+                case 'c':
+                    options.cpuHogs = std::stoul(optarg);
+                    break;
+                case 'p':
+                    options.rtPriority = std::stoi(optarg);
+                    break;
+                default:
+                    return false;
+            }
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+    }
+    return !options.buttons.empty() && !options.handler.empty();
+}
+
+static std::string writeGpioDefs(const std::string& directory)
+{
+    nlohmann::json defs = {
+        {"gpio_backend", "sim"},
+        {"gpio_definitions",
+         {{{"name", "POWER_BUTTON"},
+           {"pin", powerButtonPin},
+           {"direction", "both"}}}}};
+    auto file = directory + "/gpio_defs.json";
+    std::ofstream{file} << defs.dump();
+    return file;
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    try
+    {
+        PrivateBus privateBus;
+        FakeServices fake{1, false};
+        fake.addMapperObject(POWER_DBUS_OBJECT_NAME, buttonsService,
+                             {powerButtonIface});
+
+        // the signals are timestamped as this connection reads them
+        auto bus = sdbusplus::bus::new_system();
+        size_t pressed = 0;
+        size_t released = 0;
+        uint64_t pressedUsec = 0;
+        uint64_t releasedUsec = 0;
+        sdbusplus::bus::match_t pressedMatch{
+            bus,
+            sdbusRule::type::signal() + sdbusRule::member("Pressed") +
+                sdbusRule::interface(powerButtonIface),
+            [&](sdbusplus::message_t&) {
+            pressedUsec = getMonotonicUsec();
+            pressed++;
+        }};
+        sdbusplus::bus::match_t releasedMatch{
+            bus,
+            sdbusRule::type::signal() + sdbusRule::member("Released") +
+                sdbusRule::interface(powerButtonIface),
+            [&](sdbusplus::message_t&) {
+            releasedUsec = getMonotonicUsec();
+            released++;
+        }};
+
+        auto waitFor = [&bus](const std::function<bool()>& done,
+                              std::chrono::microseconds timeout) {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            while (true)
+            {
+                while (bus.process_discard())
+                {}
+                if (done())
+                {
+                    return true;
+                }
+                auto now = std::chrono::steady_clock::now();
+                if (now >= deadline)
+                {
+                    return false;
+                }
+                bus.wait(std::chrono::duration_cast<std::chrono::microseconds>(
+                    deadline - now));
+            }
+        };
+
+        auto simSocket = privateBus.getDirectory() + "/sim.sock";
+        auto gpioDefs = writeGpioDefs(privateBus.getDirectory());
+        std::vector<std::string> buttonsArgs{"--config", gpioDefs,
+                                             "--sim-socket", simSocket};
+        if (options.rtPriority > 0)
+        {
+            buttonsArgs.push_back("--rt-priority");
+            buttonsArgs.push_back(std::to_string(options.rtPriority));
+        }
+        Daemon handler{options.handler, "button-handler", {}};
+        Daemon buttons{options.buttons, "buttons", buttonsArgs,
+                       options.cpuHogs > 0};
+
+        if (!waitFor([&simSocket]() { return fs::exists(simSocket); },
+                     startTimeout))
+        {
+            throw std::runtime_error("The buttons daemon did not start");
+        }
+        SimControl sim{simSocket};
+
+        // one press and release through the whole chain, once the handler
+        // is ready
+        auto press = [&](uint64_t& pressUsec, uint64_t& releaseUsec) {
+            size_t sets = fake.getSets().size();
+            size_t pressedBefore = pressed;
+            size_t releasedBefore = released;
+
+            pressUsec = getMonotonicUsec();
+            if (!sim.send({{powerButtonGpio, 0, pressUsec}}) ||
+                !waitFor([&]() { return pressed > pressedBefore; },
+                         eventTimeout))
+            {
+                return false;
+            }
+            releaseUsec = getMonotonicUsec();
+            return sim.send({{powerButtonGpio, 1, releaseUsec}}) &&
+                   waitFor([&]() { return released > releasedBefore; },
+                           eventTimeout) &&
+                   fake.waitForSets(transitionProperty, sets + 1,
+                                    std::chrono::duration_cast<
+                                        std::chrono::milliseconds>(
+                                        eventTimeout));
+        };
+
+        auto startDeadline = std::chrono::steady_clock::now() + startTimeout;
+        uint64_t pressUsec = 0;
+        uint64_t releaseUsec = 0;
+        while (!press(pressUsec, releaseUsec))
+        {
+            if (std::chrono::steady_clock::now() >= startDeadline)
+            {
+                throw std::runtime_error("The button handler did not start");
+            }
+        }
+        fake.resetCalls();
+
+        // loaded once the daemons are up, their startup is not measured
+        CpuHogs hogs{options.cpuHogs};
+
+        Samples edgeToSignal;
+        Samples signalToSet;
+        Samples pressToAction;
+        size_t dropped = 0;
+        for (size_t i = 0; i < options.iterations; i++)
+        {
+            size_t sets = fake.getSets().size();
+            if (!press(pressUsec, releaseUsec))
+            {
+                dropped++;
+                continue;
+            }
+            auto set = fake.getSets().at(sets);
+            edgeToSignal.add(pressedUsec - pressUsec);
+            edgeToSignal.add(releasedUsec - releaseUsec);
+            signalToSet.add(set.usec - releasedUsec);
+            pressToAction.add(set.usec - releaseUsec);
+        }
+        size_t dbusCalls = fake.getTotalCalls();
+
+        // alternating press and release edges, the line ends up released
+        size_t signalsBefore = pressed + released;
+        std::vector<SimEdgeRecord> batch;
+        uint64_t stormStart = getMonotonicUsec();
+        uint64_t lastSignalUsec = stormStart;
+        for (size_t edge = 0; edge < options.stormEdges; edge++)
+        {
+            batch.push_back({powerButtonGpio, edge % 2 ? 1u : 0u, 0});
+            if ((batch.size() == simControlMaxBatch) ||
+                (edge + 1 == options.stormEdges))
+            {
+                if (!sim.send(batch))
+                {
+                    throw std::runtime_error("Failed to send the storm");
+                }
+                batch.clear();
+            }
+            while (bus.process_discard())
+            {}
+        }
+        size_t signalsSeen = pressed + released;
+        while (waitFor(
+            [&]() { return pressed + released > signalsSeen; },
+            stormQuietTime))
+        {
+            signalsSeen = pressed + released;
+            lastSignalUsec = std::max(pressedUsec, releasedUsec);
+        }
+        size_t stormSignals = signalsSeen - signalsBefore;
+        uint64_t stormUsec = std::max<uint64_t>(lastSignalUsec - stormStart,
+                                                1);
+
+        nlohmann::json results = {
+            {"iterations", options.iterations},
+            {"cpu_hogs", options.cpuHogs},
+            {"rt_priority", options.rtPriority},
+            {"dropped_presses", dropped},
+            {"dbus_calls_per_press",
+             (options.iterations > dropped)
+                 ? static_cast<double>(dbusCalls) /
+                       (options.iterations - dropped)
+                 : 0.0},
+            {"edge_to_signal_us", edgeToSignal.toJson()},
+            {"signal_to_set_us", signalToSet.toJson()},
+            {"press_to_action_us", pressToAction.toJson()},
+            {"storm",
+             {{"edges", options.stormEdges},
+              {"signals", stormSignals},
+              {"elapsed_us", stormUsec},
+              {"events_per_sec", stormSignals * 1000000.0 / stormUsec}}}};
+
+        auto text = results.dump(4);
+        std::cout << text << std::endl;
+        if (!options.output.empty())
+        {
+            std::ofstream{options.output} << text << std::endl;
+        }
+        return dropped == 0 ? 0 : 1;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Benchmark failed: " << e.what() << "\n";
+        return 1;
+    }
+}
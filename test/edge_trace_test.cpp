@@ -0,0 +1,214 @@
+#include "edge_trace.hpp"
+
+#include "gpio_backend.hpp"
+
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+constexpr uint32_t gpioNumber = 20;
+
+/**
+ * Replays edge traces to a simulated gpio from an event loop of its own,
+ * the trace files live in a temporary directory.
+ */
+class EdgeTraceTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        char dirTemplate[] = "/tmp/edge-trace-test-XXXXXX";
+        ASSERT_NE(::mkdtemp(dirTemplate), nullptr);
+        directory = dirTemplate;
+
+        sd_event* events = nullptr;
+        ASSERT_GE(sd_event_new(&events), 0);
+        event.reset(events);
+
+        gpio = {-1, gpioNumber, "test", "both", GpioPolarity::activeLow};
+        ASSERT_EQ(backend.open(gpio), 0);
+    }
+
+    void TearDown() override
+    {
+        backend.close(gpio.fd);
+        std::filesystem::remove_all(directory);
+    }
+
+    std::string writeTrace(const std::vector<EdgeTraceRecord>& records)
+    {
+        auto path = directory + "/replay.trace";
+        std::ofstream trace{path, std::ios::binary};
+        EdgeTraceHeader header{edgeTraceMagic, edgeTraceVersion};
+        trace.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto& record : records)
+        {
+            trace.write(reinterpret_cast<const char*>(&record),
+                        sizeof(record));
+        }
+        return path;
+    }
+
+    /**
+     * @brief runs the loop until count edges reached the simulated gpio
+     */
+    std::vector<GpioEdge> replayEdges(size_t count)
+    {
+        std::vector<GpioEdge> edges;
+        auto end = getMonotonicUsec() + 5000000;
+        while ((edges.size() < count) && (getMonotonicUsec() < end))
+        {
+            sd_event_run(event.get(), 10000);
+
+            struct pollfd pfd
+            {
+                gpio.fd, POLLIN, 0
+            };
+            while ((::poll(&pfd, 1, 0) == 1) && (edges.size() < count))
+            {
+                GpioEdge edge{};
+                EXPECT_EQ(backend.read(gpio.fd, edge), 0);
+                edges.push_back(edge);
+            }
+        }
+        return edges;
+    }
+
+    std::string directory;
+    EventPtr event;
+    SimGpioBackend backend;
+    gpioInfo gpio;
+};
+
+TEST_F(EdgeTraceTest, RecordsEdges)
+{
+    auto path = directory + "/record.trace";
+    auto& trace = EdgeTrace::instance();
+    ASSERT_TRUE(trace.open(path));
+    EXPECT_TRUE(trace.enabled());
+
+    trace.record(gpioNumber, {false, 1000});
+    trace.record(gpioNumber, {true, 2500});
+    trace.record(gpioNumber + 1, {false, 4000});
+
+    std::ifstream file{path, std::ios::binary};
+    EdgeTraceHeader header{};
+    ASSERT_TRUE(file.read(reinterpret_cast<char*>(&header), sizeof(header)));
+    EXPECT_EQ(header.magic, edgeTraceMagic);
+    EXPECT_EQ(header.version, edgeTraceVersion);
+
+    std::vector<EdgeTraceRecord> records;
+    EdgeTraceRecord record{};
+    while (file.read(reinterpret_cast<char*>(&record), sizeof(record)))
+    {
+        records.push_back(record);
+    }
+    ASSERT_EQ(records.size(), 3);
+    EXPECT_EQ(records[0].timestamp, 1000);
+    EXPECT_EQ(records[0].number, gpioNumber);
+    EXPECT_EQ(records[0].high, 0);
+    EXPECT_EQ(records[1].timestamp, 2500);
+    EXPECT_EQ(records[1].high, 1);
+    EXPECT_EQ(records[2].number, gpioNumber + 1);
+}
+
+TEST_F(EdgeTraceTest, FastReplayKeepsSpacing)
+{
+    // a long press as recorded, the fast replay does not wait for it but
+    // the edges keep their spacing from the start of the replay
+    auto path = writeTrace({{1000000, gpioNumber, 0},
+                            {6000000, gpioNumber, 1},
+                            {6500000, gpioNumber, 0}});
+    EdgeTraceReplay replay{event, backend, path, false};
+
+    auto start = getMonotonicUsec();
+    ASSERT_TRUE(replay.start());
+    auto edges = replayEdges(3);
+    auto end = getMonotonicUsec();
+
+    ASSERT_EQ(edges.size(), 3);
+    EXPECT_FALSE(edges[0].high);
+    EXPECT_TRUE(edges[1].high);
+    EXPECT_FALSE(edges[2].high);
+    EXPECT_GE(edges[0].timestamp, start);
+    EXPECT_LE(edges[0].timestamp, end);
+    EXPECT_EQ(edges[1].timestamp - edges[0].timestamp, 5000000);
+    EXPECT_EQ(edges[2].timestamp - edges[0].timestamp, 5500000);
+    for (const auto& edge : edges)
+    {
+        EXPECT_TRUE(edge.synthetic);
+    }
+    EXPECT_LT(end - start, 1000000);
+}
+
+TEST_F(EdgeTraceTest, RealTimeReplayKeepsSpacing)
+{
+    auto path = writeTrace({{1000000, gpioNumber, 0},
+                            {1100000, gpioNumber, 1},
+                            {1250000, gpioNumber, 0}});
+    EdgeTraceReplay replay{event, backend, path, true};
+
+    auto start = getMonotonicUsec();
+    ASSERT_TRUE(replay.start());
+    auto edges = replayEdges(3);
+    auto end = getMonotonicUsec();
+
+    ASSERT_EQ(edges.size(), 3);
+    EXPECT_GE(edges[0].timestamp, start);
+    EXPECT_EQ(edges[1].timestamp - edges[0].timestamp, 100000);
+    EXPECT_EQ(edges[2].timestamp - edges[0].timestamp, 250000);
+    EXPECT_GE(end - start, 250000);
+    EXPECT_TRUE(edges[2].synthetic);
+}
+
+TEST_F(EdgeTraceTest, InvalidTraceIsNotReplayed)
+{
+    auto path = directory + "/invalid.trace";
+    std::ofstream{path} << "not a trace";
+    EdgeTraceReplay invalid{event, backend, path, false};
+    EXPECT_FALSE(invalid.start());
+
+    EdgeTraceReplay empty{event, backend, writeTrace({}), false};
+    EXPECT_FALSE(empty.start());
+
+    EdgeTraceReplay missing{event, backend, directory + "/missing", false};
+    EXPECT_FALSE(missing.start());
+}
+
+TEST_F(EdgeTraceTest, TimerCaughtUpByLaterEdge)
+{
+    // a timer armed from a replayed edge, ahead of the loop clock
+    uint64_t due = getMonotonicUsec() + 10000000;
+    uint64_t ran = 0;
+    auto handler = [](sd_event_source* /* es */, uint64_t usec,
+                      void* userdata) {
+        *static_cast<uint64_t*>(userdata) = usec;
+        return 0;
+    };
+    sd_event_source* source = nullptr;
+    ASSERT_GE(sd_event_add_time(event.get(), &source, CLOCK_MONOTONIC, due, 0,
+                                handler, &ran),
+              0);
+    EventSourcePtr timer{source};
+
+    // an edge before the timer is due leaves it armed
+    EXPECT_FALSE(runTimerIfDue(timer.get(), due - 1, handler, &ran));
+    EXPECT_EQ(ran, 0);
+
+    // an edge after it runs the timer, with the time it was due at, once
+    EXPECT_TRUE(runTimerIfDue(timer.get(), due + 1, handler, &ran));
+    EXPECT_EQ(ran, due);
+    EXPECT_FALSE(runTimerIfDue(timer.get(), due + 2, handler, &ran));
+}
+
+} // namespace
@@ -0,0 +1,258 @@
+#include "config.h"
+
+#include "button_factory.hpp"
+#include "common.hpp"
+#include "edge_event.hpp"
+#include "gpio_backend.hpp"
+#include "id_button.hpp"
+#include "power_button.hpp"
+#include "private_bus.hpp"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <sdbusplus/bus.hpp>
+
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace phosphor
+{
+namespace button
+{
+namespace test
+{
+
+// edges queued on the ID button ahead of the power button press
+constexpr uint64_t idEdges = 50;
+
+/**
+ * Stands in for the gpio lines with eventfds in semaphore mode, each edge
+ * queued on a line keeps its io source readable for one more dispatch. The
+ * sources are added at the priorities the buttons give their gpios, and the
+ * order the loop dispatches them in is recorded.
+ */
+class EventPriorityTest : public ::testing::Test
+{
+  protected:
+    struct Line
+    {
+        EventPriorityTest* test;
+        std::string name;
+        int fd;
+        EventSourcePtr source;
+    };
+
+    void SetUp() override
+    {
+        sd_event* events = nullptr;
+        ASSERT_GE(sd_event_new(&events), 0);
+        event.reset(events);
+    }
+
+    void TearDown() override
+    {
+        for (auto& line : lines)
+        {
+            line.source.reset();
+            ::close(line.fd);
+        }
+    }
+
+    static int lineHandler(sd_event_source* /* es */, int fd,
+                           uint32_t /* revents */, void* userdata)
+    {
+        auto* line = static_cast<Line*>(userdata);
+        uint64_t value = 0;
+        if (::read(fd, &value, sizeof(value)) == sizeof(value))
+        {
+            line->test->dispatched.push_back(line->name);
+        }
+        return 0;
+    }
+
+    void addLine(std::string_view name, int64_t priority, uint64_t edges)
+    {
+        int fd = ::eventfd(edges, EFD_SEMAPHORE | EFD_NONBLOCK | EFD_CLOEXEC);
+        ASSERT_GE(fd, 0);
+        auto& line = lines.emplace_back(Line{this, std::string{name}, fd, {}});
+
+        sd_event_source* source = nullptr;
+        ASSERT_GE(sd_event_add_io(event.get(), &source, fd, EPOLLIN,
+                                  lineHandler, &line),
+                  0);
+        line.source.reset(source);
+        ASSERT_GE(sd_event_source_set_priority(source, priority), 0);
+    }
+
+    /**
+     * @brief queues the ID button edges, then a power button press, and
+     * runs the loop until all of them were dispatched
+     */
+    void run(int64_t idPriority, int64_t powerPriority)
+    {
+        addLine(ID_BUTTON, idPriority, idEdges);
+        addLine(POWER_BUTTON, powerPriority, 1);
+
+        while (sd_event_run(event.get(), 0) > 0)
+        {}
+        ASSERT_EQ(dispatched.size(), idEdges + 1);
+    }
+
+    EventPtr event;
+    // the io sources keep a pointer to their line
+    std::deque<Line> lines;
+    std::vector<std::string> dispatched;
+};
+
+TEST_F(EventPriorityTest, PowerEdgeAheadOfIdBurst)
+{
+    // the power button is in the high class, the ID button in the normal
+    // one: the press is handled first however many edges are pending
+    run(IDButton::getDefaultEventPriority(),
+        PowerButton::getDefaultEventPriority());
+    EXPECT_EQ(dispatched.front(), POWER_BUTTON);
+}
+
+TEST_F(EventPriorityTest, ConfiguredPriorityOverridesDefault)
+{
+    // the power button now waits for the whole ID burst
+    run(getEventPriority("high", eventPriorityNormal),
+        getEventPriority("low", eventPriorityNormal));
+    EXPECT_EQ(dispatched.back(), POWER_BUTTON);
+}
+
+/**
+ * Creates a power and an ID button on simulated gpios and queues a burst of
+ * ID button edges ahead of a single power button edge, before the event
+ * loop gets to run. The order the edges reach the edge listeners is the
+ * order the loop dispatched the io sources of the buttons in.
+ */
+class ButtonPriorityTest : public ::testing::Test
+{
+  protected:
+    static void SetUpTestSuite()
+    {
+        ASSERT_TRUE(setGpioBackend("sim"));
+
+        // the edge dispatcher has no way to remove a listener, a single
+        // one serves all the tests
+        EdgeDispatcher::instance().addListener([](const EdgeEvent& edge) {
+            if (dispatched != nullptr)
+            {
+                dispatched->emplace_back(edge.button);
+            }
+        });
+    }
+
+    void SetUp() override
+    {
+        sd_event* events = nullptr;
+        ASSERT_GE(sd_event_new(&events), 0);
+        event.reset(events);
+        bus.attach_event(event.get(), SD_EVENT_PRIORITY_NORMAL);
+        dispatched = &buttons;
+    }
+
+    void TearDown() override
+    {
+        dispatched = nullptr;
+        power.reset();
+        id.reset();
+    }
+
+    std::unique_ptr<ButtonIface>
+        createButton(std::string_view name, uint32_t number,
+                     std::optional<int64_t> priority = std::nullopt)
+    {
+        buttonConfig config;
+        config.formFactorName = name;
+        config.extraJsonInfo = {{"name", std::string{name}}};
+        config.eventPriority = priority;
+        config.gpios.push_back(
+            {-1, number, std::string{name}, "both", GpioPolarity::activeLow});
+        return ButtonFactory::createInstance(config.formFactorName, bus,
+                                             event, config);
+    }
+
+    /**
+     * @brief queues the ID button edges, then a power button press, and
+     * runs the loop until all of them were dispatched
+     */
+    void injectAndRun(uint32_t idNumber, uint32_t powerNumber)
+    {
+        auto& backend = static_cast<SimGpioBackend&>(getGpioBackend());
+        uint64_t now = getMonotonicUsec();
+        for (size_t index = 0; index < idEdges; index++)
+        {
+            ASSERT_TRUE(backend.inject(idNumber, {index % 2 != 0, now}));
+        }
+        ASSERT_TRUE(backend.inject(powerNumber, {false, now}));
+
+        auto end = now + 5000000;
+        while ((buttons.size() < idEdges + 1) && (getMonotonicUsec() < end))
+        {
+            sd_event_run(event.get(), 10000);
+        }
+        ASSERT_EQ(buttons.size(), idEdges + 1);
+    }
+
+    static std::vector<std::string>* dispatched;
+
+    PrivateBus privateBus;
+    sdbusplus::bus_t bus = sdbusplus::bus::new_system();
+    EventPtr event;
+    std::vector<std::string> buttons;
+    std::unique_ptr<ButtonIface> power;
+    std::unique_ptr<ButtonIface> id;
+};
+
+std::vector<std::string>* ButtonPriorityTest::dispatched = nullptr;
+
+TEST_F(ButtonPriorityTest, PowerEdgeAheadOfIdBurst)
+{
+    id = createButton(ID_BUTTON, 30);
+    power = createButton(POWER_BUTTON, 31);
+    ASSERT_TRUE(id);
+    ASSERT_TRUE(power);
+
+    // the buttons give their io sources their own default classes
+    injectAndRun(30, 31);
+    EXPECT_EQ(buttons.front(), POWER_BUTTON);
+}
+
+TEST_F(ButtonPriorityTest, ConfiguredPriorityOverridesDefault)
+{
+    id = createButton(ID_BUTTON, 40, eventPriorityHigh);
+    power = createButton(POWER_BUTTON, 41, eventPriorityLow);
+    ASSERT_TRUE(id);
+    ASSERT_TRUE(power);
+
+    // the event_priority of the gpio config is used over the default one
+    injectAndRun(40, 41);
+    EXPECT_EQ(buttons.back(), POWER_BUTTON);
+}
+
+TEST(EventPriorityClassTest, ClassNames)
+{
+    EXPECT_EQ(getEventPriority("high", 0), eventPriorityHigh);
+    EXPECT_EQ(getEventPriority("normal", 0), eventPriorityNormal);
+    EXPECT_EQ(getEventPriority("low", 0), eventPriorityLow);
+    EXPECT_EQ(getEventPriority("bus", 0), SD_EVENT_PRIORITY_NORMAL);
+    EXPECT_EQ(getEventPriority("bogus", 7), 7);
+
+    // the gpio classes are all dispatched ahead of the bus
+    EXPECT_LT(eventPriorityHigh, eventPriorityNormal);
+    EXPECT_LT(eventPriorityNormal, eventPriorityLow);
+    EXPECT_LT(eventPriorityLow, SD_EVENT_PRIORITY_NORMAL);
+}
+
+} // namespace test
+} // namespace button
+} // namespace phosphor
@@ -0,0 +1,508 @@
+#include "config.h"
+
+#include "fake_services.hpp"
+
+#include "gpio_backend.hpp"
+
+#include <poll.h>
+
+#include <sdbusplus/vtable.hpp>
+
+#include <algorithm>
+
+namespace phosphor
+{
+namespace button
+{
+namespace test
+{
+
+namespace property = sdbusplus::vtable::property_;
+
+constexpr auto mapperPath = "/xyz/openbmc_project/object_mapper";
+constexpr auto mapperInterface = "xyz.openbmc_project.ObjectMapper";
+constexpr auto hostIface = "xyz.openbmc_project.State.Host";
+constexpr auto chassisIface = "xyz.openbmc_project.State.Chassis";
+constexpr auto ledGroupIface = "xyz.openbmc_project.Led.Group";
+constexpr auto ledGroupBasePath = "/xyz/openbmc_project/led/groups/";
+constexpr auto hostSelectorIface =
+    "xyz.openbmc_project.Chassis.Buttons.HostSelector";
+constexpr auto notFoundError =
+    "xyz.openbmc_project.Common.Error.ResourceNotFound";
+
+constexpr auto hostOff = "xyz.openbmc_project.State.Host.HostState.Off";
+constexpr auto hostRunning =
+    "xyz.openbmc_project.State.Host.HostState.Running";
+constexpr auto chassisOff = "xyz.openbmc_project.State.Chassis.PowerState.Off";
+constexpr auto chassisOn = "xyz.openbmc_project.State.Chassis.PowerState.On";
+
+// how long the service thread waits for the bus before it checks whether
+// it is stopping
+constexpr int servicePollMs = 5;
+
+const sd_bus_vtable FakeServices::mapperVtable[] = {
+    sdbusplus::vtable::start(),
+    sdbusplus::vtable::method("GetObject", "sas", "a{sas}",
+                              FakeServices::getObject),
+    sdbusplus::vtable::method("GetSubTreePaths", "sias", "as",
+                              FakeServices::getSubTreePaths),
+    sdbusplus::vtable::end()};
+
+const sd_bus_vtable FakeServices::hostVtable[] = {
+    sdbusplus::vtable::start(),
+    sdbusplus::vtable::property("CurrentHostState", "s",
+                                FakeServices::getProperty,
+                                property::emits_change),
+    sdbusplus::vtable::property("RequestedHostTransition", "s",
+                                FakeServices::getProperty,
+                                FakeServices::setProperty,
+                                property::emits_change),
+    sdbusplus::vtable::end()};
+
+const sd_bus_vtable FakeServices::chassisVtable[] = {
+    sdbusplus::vtable::start(),
+    sdbusplus::vtable::property("CurrentPowerState", "s",
+                                FakeServices::getProperty,
+                                property::emits_change),
+    sdbusplus::vtable::property("RequestedPowerTransition", "s",
+                                FakeServices::getProperty,
+                                FakeServices::setProperty,
+                                property::emits_change),
+    sdbusplus::vtable::end()};
+
+const sd_bus_vtable FakeServices::ledVtable[] = {
+    sdbusplus::vtable::start(),
+    sdbusplus::vtable::property("Asserted", "b", FakeServices::getProperty,
+                                FakeServices::setProperty,
+                                property::emits_change),
+    sdbusplus::vtable::end()};
+
+const sd_bus_vtable FakeServices::hostSelectorVtable[] = {
+    sdbusplus::vtable::start(),
+    sdbusplus::vtable::property("Position", "t", FakeServices::getProperty,
+                                FakeServices::setProperty,
+                                property::emits_change),
+    sdbusplus::vtable::property("MaxPosition", "t", FakeServices::getProperty,
+                                property::emits_change),
+    sdbusplus::vtable::end()};
+
+FakeServices::FakeServices(size_t hosts, bool multiHost) :
+    bus(sdbusplus::bus::new_system())
+{
+    mapperIface = std::make_unique<sdbusplus::server::interface_t>(
+        bus, mapperPath, mapperInterface, mapperVtable, this);
+
+    // host 0 is the BMC on a multi-host system
+    size_t first = multiHost ? 1 : 0;
+    for (size_t host = first; host < first + hosts; host++)
+    {
+        auto number = std::to_string(host);
+        addObject(hostService, HOST_STATE_OBJECT_NAME + number, hostIface,
+                  hostVtable,
+                  {{"CurrentHostState", std::string{hostOff}},
+                   {"RequestedHostTransition",
+                    std::string{"xyz.openbmc_project.State.Host."
+                                "Transition.Off"}}});
+        addObject(chassisService, CHASSIS_STATE_OBJECT_NAME + number,
+                  chassisIface, chassisVtable,
+                  {{"CurrentPowerState", std::string{chassisOff}},
+                   {"RequestedPowerTransition",
+                    std::string{"xyz.openbmc_project.State.Chassis."
+                                "Transition.Off"}}});
+    }
+
+    addObject(ledService, std::string{ledGroupBasePath} + ID_LED_GROUP,
+              ledGroupIface, ledVtable, {{"Asserted", false}});
+
+    if (multiHost)
+    {
+        addObject(buttonsService, HS_DBUS_OBJECT_NAME, hostSelectorIface,
+                  hostSelectorVtable,
+                  {{"Position", uint64_t{1}},
+                   {"MaxPosition", static_cast<uint64_t>(hosts)}});
+    }
+
+    std::set<std::string> services{mapperService};
+    for (const auto& [path, object] : objects)
+    {
+        services.insert(object->service);
+    }
+    for (const auto& service : services)
+    {
+        bus.request_name(service.c_str());
+    }
+
+    thread = std::thread(&FakeServices::run, this);
+}
+
+FakeServices::~FakeServices()
+{
+    stopping = true;
+    thread.join();
+}
+
+void FakeServices::addObject(const std::string& service,
+                             const std::string& path,
+                             const std::string& interface,
+                             const sd_bus_vtable* vtable,
+                             std::map<std::string, FakeValue> properties)
+{
+    auto object = std::make_unique<Object>();
+    object->owner = this;
+    object->service = service;
+    object->path = path;
+    object->interface = interface;
+    object->properties = std::move(properties);
+    object->serverIface = std::make_unique<sdbusplus::server::interface_t>(
+        bus, object->path.c_str(), object->interface.c_str(), vtable,
+        object.get());
+
+    mapperObjects[path][service].insert(interface);
+    objects.emplace(path, std::move(object));
+}
+
+void FakeServices::addMapperObject(const std::string& path,
+                                   const std::string& service,
+                                   const std::vector<std::string>& interfaces)
+{
+    std::lock_guard lock{mutex};
+    mapperObjects[path][service].insert(interfaces.begin(), interfaces.end());
+}
+
+void FakeServices::setBehavior(const std::string& service,
+                               const FakeBehavior& behavior)
+{
+    std::lock_guard lock{mutex};
+    behaviors[service] = behavior;
+}
+
+void FakeServices::setProperty(const std::string& path,
+                               const std::string& property,
+                               const FakeValue& value)
+{
+    std::lock_guard lock{mutex};
+    auto& object = *objects.at(path);
+    object.properties.at(property) = value;
+    emitChanged(object, property);
+}
+
+FakeValue FakeServices::getProperty(const std::string& path,
+                                    const std::string& property)
+{
+    std::lock_guard lock{mutex};
+    return objects.at(path)->properties.at(property);
+}
+
+void FakeServices::setCompleteTransitions(bool complete)
+{
+    std::lock_guard lock{mutex};
+    completeTransitions = complete;
+}
+
+size_t FakeServices::getCallCount(const std::string& call)
+{
+    std::lock_guard lock{mutex};
+    auto it = calls.find(call);
+    return (it != calls.end()) ? it->second : 0;
+}
+
+size_t FakeServices::getTotalCalls()
+{
+    std::lock_guard lock{mutex};
+    size_t total = 0;
+    for (const auto& [call, count] : calls)
+    {
+        total += count;
+    }
+    return total;
+}
+
+void FakeServices::resetCalls()
+{
+    std::lock_guard lock{mutex};
+    calls.clear();
+    sets.clear();
+}
+
+std::vector<FakeSet> FakeServices::getSets()
+{
+    std::lock_guard lock{mutex};
+    return sets;
+}
+
+bool FakeServices::waitForSets(const std::string& property, size_t count,
+                               std::chrono::milliseconds timeout)
+{
+    std::unique_lock lock{mutex};
+    return setReceived.wait_for(lock, timeout, [this, &property, count]() {
+        return static_cast<size_t>(std::count_if(
+                   sets.begin(), sets.end(), [&property](const auto& set) {
+            return set.property == property;
+        })) >= count;
+    });
+}
+
+int FakeServices::enterCall(const std::string& service,
+                            const std::string& call, sd_bus_error* error)
+{
+    // the getters also run for the PropertiesChanged signals, which are not
+    // calls. A GetAll reads each property through the getter, it is one call.
+    auto* currentMsg = sd_bus_get_current_message(bus.get());
+    if (currentMsg == nullptr)
+    {
+        return 0;
+    }
+    sdbusplus::message_t current{currentMsg};
+    uint64_t cookie = current.get_cookie();
+    std::string sender = current.get_sender();
+    if ((cookie == lastCookie) && (sender == lastSender))
+    {
+        return (lastResult < 0) ? sd_bus_error_set_errno(error, -lastResult)
+                                : 0;
+    }
+    lastCookie = cookie;
+    lastSender = sender;
+
+    calls[call]++;
+
+    auto behavior = behaviors[service];
+    if (behavior.latency.count() > 0)
+    {
+        std::this_thread::sleep_for(behavior.latency);
+    }
+
+    lastResult = 0;
+    if (behavior.error != 0)
+    {
+        lastResult = sd_bus_error_set_errno(error, behavior.error);
+    }
+    return lastResult;
+}
+
+void FakeServices::emitChanged(const Object& object,
+                               const std::string& property)
+{
+    sd_bus_emit_properties_changed(bus.get(), object.path.c_str(),
+                                   object.interface.c_str(), property.c_str(),
+                                   nullptr);
+}
+
+void FakeServices::completeTransition(Object& object,
+                                      const std::string& property,
+                                      const std::string& value)
+{
+    bool off = value.ends_with(".Off");
+    if (property == "RequestedHostTransition")
+    {
+        object.properties["CurrentHostState"] =
+            std::string{off ? hostOff : hostRunning};
+        emitChanged(object, "CurrentHostState");
+    }
+    else if (property == "RequestedPowerTransition")
+    {
+        object.properties["CurrentPowerState"] =
+            std::string{off ? chassisOff : chassisOn};
+        emitChanged(object, "CurrentPowerState");
+    }
+}
+
+void FakeServices::run()
+{
+    int fd = sd_bus_get_fd(bus.get());
+    while (!stopping)
+    {
+        {
+            std::lock_guard lock{mutex};
+            while (bus.process_discard())
+            {}
+        }
+
+        struct pollfd pfd
+        {
+            fd, POLLIN, 0
+        };
+        ::poll(&pfd, 1, servicePollMs);
+    }
+}
+
+int FakeServices::getObject(sd_bus_message* msg, void* userdata,
+                            sd_bus_error* error)
+{
+    auto* fake = static_cast<FakeServices*>(userdata);
+    sdbusplus::message_t message{msg};
+
+    std::string path;
+    std::vector<std::string> interfaces;
+    try
+    {
+        message.read(path, interfaces);
+    }
+    catch (const sdbusplus::exception_t&)
+    {
+        return sd_bus_error_set(error, SD_BUS_ERROR_INVALID_ARGS,
+                                "Malformed GetObject call");
+    }
+
+    int ret = fake->enterCall(mapperService, "GetObject", error);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    std::map<std::string, std::vector<std::string>> result;
+    auto object = fake->mapperObjects.find(path);
+    if (object != fake->mapperObjects.end())
+    {
+        for (const auto& [service, implemented] : object->second)
+        {
+            std::vector<std::string> matching;
+            for (const auto& interface : implemented)
+            {
+                if (interfaces.empty() ||
+                    (std::find(interfaces.begin(), interfaces.end(),
+                               interface) != interfaces.end()))
+                {
+                    matching.push_back(interface);
+                }
+            }
+            if (!matching.empty())
+            {
+                result.emplace(service, std::move(matching));
+            }
+        }
+    }
+
+    if (result.empty())
+    {
+        return sd_bus_error_set(error, notFoundError,
+                                "The resource is not found.");
+    }
+
+    auto reply = message.new_method_return();
+    reply.append(result);
+    reply.method_return();
+    return 1;
+}
+
+int FakeServices::getSubTreePaths(sd_bus_message* msg, void* userdata,
+                                  sd_bus_error* error)
+{
+    auto* fake = static_cast<FakeServices*>(userdata);
+    sdbusplus::message_t message{msg};
+
+    std::string subtree;
+    int32_t depth = 0;
+    std::vector<std::string> interfaces;
+    try
+    {
+        message.read(subtree, depth, interfaces);
+    }
+    catch (const sdbusplus::exception_t&)
+    {
+        return sd_bus_error_set(error, SD_BUS_ERROR_INVALID_ARGS,
+                                "Malformed GetSubTreePaths call");
+    }
+
+    int ret = fake->enterCall(mapperService, "GetSubTreePaths", error);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    // the depth is not limited, the fake objects are few
+    std::vector<std::string> paths;
+    for (const auto& [path, services] : fake->mapperObjects)
+    {
+        if (!path.starts_with(subtree + "/"))
+        {
+            continue;
+        }
+        for (const auto& [service, implemented] : services)
+        {
+            if (interfaces.empty() ||
+                std::any_of(interfaces.begin(), interfaces.end(),
+                            [&implemented](const auto& interface) {
+                return implemented.contains(interface);
+            }))
+            {
+                paths.push_back(path);
+                break;
+            }
+        }
+    }
+
+    auto reply = message.new_method_return();
+    reply.append(paths);
+    reply.method_return();
+    return 1;
+}
+
+int FakeServices::getProperty(sd_bus* bus, const char* /* path */,
+                              const char* /* interface */,
+                              const char* property, sd_bus_message* reply,
+                              void* userdata, sd_bus_error* error)
+{
+    auto* object = static_cast<Object*>(userdata);
+    auto* currentMsg = sd_bus_get_current_message(bus);
+    if (currentMsg != nullptr)
+    {
+        sdbusplus::message_t current{currentMsg};
+        std::string member = current.get_member();
+        auto call = (member == "GetAll") ? member : member + " " + property;
+
+        int ret = object->owner->enterCall(object->service, call, error);
+        if (ret < 0)
+        {
+            return ret;
+        }
+    }
+
+    sdbusplus::message_t message{reply};
+    std::visit([&message](const auto& value) { message.append(value); },
+               object->properties.at(property));
+    return 1;
+}
+
+int FakeServices::setProperty(sd_bus* /* bus */, const char* /* path */,
+                              const char* /* interface */,
+                              const char* property, sd_bus_message* value,
+                              void* userdata, sd_bus_error* error)
+{
+    auto* object = static_cast<Object*>(userdata);
+    auto& fake = *object->owner;
+    std::string name{property};
+
+    int ret = fake.enterCall(object->service, "Set " + name, error);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    sdbusplus::message_t message{value};
+    auto& stored = object->properties.at(name);
+    try
+    {
+        std::visit([&message](auto& current) { message.read(current); },
+                   stored);
+    }
+    catch (const sdbusplus::exception_t&)
+    {
+        return sd_bus_error_set(error, SD_BUS_ERROR_INVALID_ARGS,
+                                "Wrong property type");
+    }
+    uint64_t usec = getMonotonicUsec();
+
+    fake.emitChanged(*object, name);
+    if (fake.completeTransitions && std::holds_alternative<std::string>(stored))
+    {
+        fake.completeTransition(*object, name, std::get<std::string>(stored));
+    }
+
+    fake.sets.push_back({object->path, name, stored, usec});
+    fake.setReceived.notify_all();
+    return 1;
+}
+
+} // namespace test
+} // namespace button
+} // namespace phosphor
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/server/interface.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+namespace phosphor
+{
+namespace button
+{
+namespace test
+{
+
+constexpr auto mapperService = "xyz.openbmc_project.ObjectMapper";
+constexpr auto hostService = "xyz.openbmc_project.State.Host";
+constexpr auto chassisService = "xyz.openbmc_project.State.Chassis";
+constexpr auto ledService = "xyz.openbmc_project.LED.GroupManager";
+constexpr auto buttonsService = "xyz.openbmc_project.Chassis.Buttons";
+
+using FakeValue = std::variant<std::string, bool, uint64_t>;
+
+// how a fake service answers
+struct FakeBehavior
+{
+    // time each call takes before it is answered
+    std::chrono::microseconds latency{0};
+    // errno the calls fail with, 0 to answer them
+    int error = 0;
+};
+
+// a property Set received by a fake service
+struct FakeSet
+{
+    std::string path;
+    std::string property;
+    FakeValue value;
+    // getMonotonicUsec() once the Set is applied
+    uint64_t usec;
+};
+
+/**
+ * @class FakeServices
+ *
+ * Stand-ins for the services the button handler talks to: the object
+ * mapper, the host and chassis state managers of each host, the identify
+ * LED group and, on a multi-host system, the host selector of the buttons
+ * daemon. They are served from a thread with its own connection to the
+ * (private) bus, so the handler under test can make blocking calls to them.
+ *
+ * Each service has a FakeBehavior for latency and failure injection. Every
+ * method call and property access is counted, e.g. "GetObject", "Get
+ * CurrentHostState" or "Set RequestedHostTransition", and the property Sets
+ * are recorded with their time. A requested host or chassis transition
+ * completes right away unless disabled: the current state follows the
+ * request, with the PropertiesChanged signal a state manager would send.
+ *
+ * The mapper also lists the objects added with addMapperObject(), such as
+ * the buttons served by the buttons daemon.
+ */
+class FakeServices
+{
+  public:
+    FakeServices(const FakeServices&) = delete;
+    FakeServices& operator=(const FakeServices&) = delete;
+    FakeServices(FakeServices&&) = delete;
+    FakeServices& operator=(FakeServices&&) = delete;
+
+    /**
+     * @brief serves hosts 0 to hosts - 1 on a single host system, and the
+     * host selector along with hosts 1 to hosts on a multi-host one
+     */
+    FakeServices(size_t hosts, bool multiHost);
+    ~FakeServices();
+
+    /**
+     * @brief lists an object served by another process in the mapper
+     */
+    void addMapperObject(const std::string& path, const std::string& service,
+                         const std::vector<std::string>& interfaces);
+
+    void setBehavior(const std::string& service, const FakeBehavior& behavior);
+
+    /**
+     * @brief changes a property of a fake object, with its PropertiesChanged
+     * signal
+     */
+    void setProperty(const std::string& path, const std::string& property,
+                     const FakeValue& value);
+    FakeValue getProperty(const std::string& path,
+                          const std::string& property);
+
+    void setCompleteTransitions(bool complete);
+
+    size_t getCallCount(const std::string& call);
+    size_t getTotalCalls();
+    void resetCalls();
+
+    std::vector<FakeSet> getSets();
+
+    /**
+     * @brief waits until at least count Sets of the property were received
+     * @return false on timeout
+     */
+    bool waitForSets(const std::string& property, size_t count,
+                     std::chrono::milliseconds timeout);
+
+  private:
+    struct Object
+    {
+        FakeServices* owner;
+        std::string service;
+        std::string path;
+        std::string interface;
+        std::map<std::string, FakeValue> properties;
+        std::unique_ptr<sdbusplus::server::interface_t> serverIface;
+    };
+
+    void addObject(const std::string& service, const std::string& path,
+                   const std::string& interface, const sd_bus_vtable* vtable,
+                   std::map<std::string, FakeValue> properties);
+
+    /**
+     * @brief sleeps for the latency of the service and counts the call, once
+     * per D-Bus message when a GetAll reads several properties
+     * @return negative errno if the call is to fail, 0 otherwise
+     */
+    int enterCall(const std::string& service, const std::string& call,
+                  sd_bus_error* error);
+
+    void completeTransition(Object& object, const std::string& property,
+                            const std::string& value);
+    void emitChanged(const Object& object, const std::string& property);
+
+    void run();
+
+    static const sd_bus_vtable mapperVtable[];
+    static const sd_bus_vtable hostVtable[];
+    static const sd_bus_vtable chassisVtable[];
+    static const sd_bus_vtable ledVtable[];
+    static const sd_bus_vtable hostSelectorVtable[];
+
+    static int getObject(sd_bus_message* msg, void* userdata,
+                         sd_bus_error* error);
+    static int getSubTreePaths(sd_bus_message* msg, void* userdata,
+                               sd_bus_error* error);
+    static int getProperty(sd_bus* bus, const char* path,
+                           const char* interface, const char* property,
+                           sd_bus_message* reply, void* userdata,
+                           sd_bus_error* error);
+    static int setProperty(sd_bus* bus, const char* path,
+                           const char* interface, const char* property,
+                           sd_bus_message* value, void* userdata,
+                           sd_bus_error* error);
+
+    sdbusplus::bus_t bus;
+    std::mutex mutex;
+    std::condition_variable setReceived;
+    std::unique_ptr<sdbusplus::server::interface_t> mapperIface;
+    // objects by path
+    std::map<std::string, std::unique_ptr<Object>> objects;
+    // the mapper view: interfaces by service by path
+    std::map<std::string, std::map<std::string, std::set<std::string>>>
+        mapperObjects;
+    std::map<std::string, FakeBehavior> behaviors;
+    std::map<std::string, size_t> calls;
+    std::vector<FakeSet> sets;
+    // the message the last property access was counted for
+    uint64_t lastCookie = 0;
+    std::string lastSender;
+    int lastResult = 0;
+    bool completeTransitions = true;
+    std::atomic<bool> stopping = false;
+    std::thread thread;
+};
+
+} // namespace test
+} // namespace button
+} // namespace phosphor
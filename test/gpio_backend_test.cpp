@@ -0,0 +1,188 @@
+#include "gpio_backend.hpp"
+
+#include <poll.h>
+
+#include <array>
+#include <cerrno>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+bool readable(int fd)
+{
+    struct pollfd pfd
+    {
+        fd, POLLIN, 0
+    };
+    return ::poll(&pfd, 1, 0) == 1;
+}
+
+gpioInfo makeGpio(uint32_t number)
+{
+    return {-1, number, "test", "both", GpioPolarity::activeLow};
+}
+
+} // namespace
+
+TEST(SimGpioBackendTest, LineStartsHigh)
+{
+    SimGpioBackend backend;
+    auto gpio = makeGpio(10);
+    ASSERT_EQ(backend.open(gpio), 0);
+    ASSERT_GE(gpio.fd, 0);
+    EXPECT_TRUE(backend.simulated());
+    EXPECT_FALSE(readable(gpio.fd));
+
+    // with no edge pending a read returns the level, at the current time
+    auto before = getMonotonicUsec();
+    GpioEdge edge{};
+    ASSERT_EQ(backend.read(gpio.fd, edge), 0);
+    EXPECT_TRUE(edge.high);
+    EXPECT_GE(edge.timestamp, before);
+    EXPECT_LE(edge.timestamp, getMonotonicUsec());
+
+    backend.close(gpio.fd);
+}
+
+TEST(SimGpioBackendTest, InjectedEdgesReadInOrder)
+{
+    SimGpioBackend backend;
+    auto gpio = makeGpio(10);
+    ASSERT_EQ(backend.open(gpio), 0);
+
+    ASSERT_TRUE(backend.inject(10, {false, 1000, true}));
+    ASSERT_TRUE(backend.inject(10, {true, 2000, true}));
+    EXPECT_TRUE(readable(gpio.fd));
+
+    // the timestamps are the injected ones, the line stays readable until
+    // the last pending edge is read
+    GpioEdge edge{};
+    ASSERT_EQ(backend.read(gpio.fd, edge), 0);
+    EXPECT_FALSE(edge.high);
+    EXPECT_EQ(edge.timestamp, 1000);
+    EXPECT_TRUE(edge.synthetic);
+    EXPECT_TRUE(readable(gpio.fd));
+
+    ASSERT_EQ(backend.read(gpio.fd, edge), 0);
+    EXPECT_TRUE(edge.high);
+    EXPECT_EQ(edge.timestamp, 2000);
+    EXPECT_FALSE(readable(gpio.fd));
+
+    backend.close(gpio.fd);
+}
+
+TEST(SimGpioBackendTest, LevelFollowsLastEdge)
+{
+    SimGpioBackend backend;
+    auto gpio = makeGpio(10);
+    ASSERT_EQ(backend.open(gpio), 0);
+
+    ASSERT_TRUE(backend.inject(10, {false, 1000}));
+    GpioEdge edge{};
+    ASSERT_EQ(backend.read(gpio.fd, edge), 0);
+
+    ASSERT_EQ(backend.read(gpio.fd, edge), 0);
+    EXPECT_FALSE(edge.high);
+    EXPECT_FALSE(edge.synthetic);
+
+    backend.close(gpio.fd);
+}
+
+TEST(SimGpioBackendTest, WriteSetsLevel)
+{
+    SimGpioBackend backend;
+    auto gpio = makeGpio(10);
+    ASSERT_EQ(backend.open(gpio), 0);
+
+    ASSERT_EQ(backend.write(gpio.fd, false), 0);
+    GpioEdge edge{};
+    ASSERT_EQ(backend.read(gpio.fd, edge), 0);
+    EXPECT_FALSE(edge.high);
+    EXPECT_FALSE(readable(gpio.fd));
+
+    backend.close(gpio.fd);
+}
+
+TEST(SimGpioBackendTest, ReadLevelsOfSeveralLines)
+{
+    SimGpioBackend backend;
+    auto first = makeGpio(10);
+    auto second = makeGpio(11);
+    ASSERT_EQ(backend.open(first), 0);
+    ASSERT_EQ(backend.open(second), 0);
+    ASSERT_EQ(backend.write(second.fd, false), 0);
+
+    std::array<GpioBackend::LevelRead, 3> reads{
+        {{first.fd, false, 1}, {second.fd, true, 1}, {-1, false, 0}}};
+    backend.readLevels(reads);
+    EXPECT_EQ(reads[0].result, 0);
+    EXPECT_TRUE(reads[0].high);
+    EXPECT_EQ(reads[1].result, 0);
+    EXPECT_FALSE(reads[1].high);
+    EXPECT_EQ(reads[2].result, -EBADF);
+
+    backend.close(first.fd);
+    backend.close(second.fd);
+}
+
+TEST(SimGpioBackendTest, FailingReads)
+{
+    SimGpioBackend backend;
+    auto gpio = makeGpio(10);
+    ASSERT_EQ(backend.open(gpio), 0);
+
+    // the failing line stays readable, also once opened again
+    backend.failReads(10, -EIO);
+    EXPECT_TRUE(readable(gpio.fd));
+    GpioEdge edge{};
+    EXPECT_EQ(backend.read(gpio.fd, edge), -EIO);
+    EXPECT_TRUE(readable(gpio.fd));
+
+    backend.close(gpio.fd);
+    ASSERT_EQ(backend.open(gpio), 0);
+    EXPECT_TRUE(readable(gpio.fd));
+    EXPECT_EQ(backend.read(gpio.fd, edge), -EIO);
+
+    backend.failReads(10, 0);
+    EXPECT_EQ(backend.read(gpio.fd, edge), 0);
+    EXPECT_FALSE(readable(gpio.fd));
+
+    backend.close(gpio.fd);
+}
+
+TEST(SimGpioBackendTest, UnknownLines)
+{
+    SimGpioBackend backend;
+    auto gpio = makeGpio(10);
+    ASSERT_EQ(backend.open(gpio), 0);
+
+    EXPECT_FALSE(backend.inject(11, {false, 1000}));
+
+    // the line is gone once closed
+    backend.close(gpio.fd);
+    GpioEdge edge{};
+    EXPECT_EQ(backend.read(gpio.fd, edge), -EBADF);
+    EXPECT_EQ(backend.write(gpio.fd, true), -EBADF);
+    EXPECT_FALSE(backend.inject(10, {false, 1000}));
+}
+
+TEST(GpioBackendTest, SelectByName)
+{
+    EXPECT_FALSE(getGpioBackend().simulated());
+    EXPECT_FALSE(setGpioBackend("bogus"));
+
+    ASSERT_TRUE(setGpioBackend("sim"));
+    EXPECT_TRUE(getGpioBackend().simulated());
+
+    // the gpios configured from then on are simulated
+    auto gpio = makeGpio(3);
+    ASSERT_EQ(configGpio(gpio), 0);
+    GpioEdge edge{};
+    EXPECT_EQ(getGpioBackend().read(gpio.fd, edge), 0);
+    closeGpio(gpio.fd);
+
+    ASSERT_TRUE(setGpioBackend("sysfs"));
+    EXPECT_FALSE(getGpioBackend().simulated());
+}
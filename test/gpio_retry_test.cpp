@@ -0,0 +1,168 @@
+#include "config.h"
+
+#include "button_factory.hpp"
+#include "button_interface.hpp"
+#include "common.hpp"
+#include "edge_journal.hpp"
+#include "gpio_backend.hpp"
+#include "id_button.hpp"
+#include "private_bus.hpp"
+
+#include <sdbusplus/bus.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace phosphor
+{
+namespace button
+{
+namespace test
+{
+
+// re-opens watched on the failing line, 100ms to 800ms apart
+constexpr size_t retries = 4;
+// sd-event fires a timer up to 250ms after it is due
+constexpr uint64_t timerSlackUsec = 500 * 1000;
+
+TEST(GpioBackoffTest, DoublesWhileFailingRightAfterReopen)
+{
+    GpioBackoff backoff;
+    uint64_t now = 1000;
+    EXPECT_EQ(backoff.failed(now), gpioRetryMinUsec);
+
+    uint64_t expected = gpioRetryMinUsec;
+    while (expected < gpioRetryMaxUsec)
+    {
+        now += backoff.delay;
+        backoff.reopened(now);
+        expected = std::min(expected * 2, gpioRetryMaxUsec);
+        EXPECT_EQ(backoff.failed(now), expected);
+    }
+
+    // it stays at the maximum
+    now += backoff.delay;
+    backoff.reopened(now);
+    EXPECT_EQ(backoff.failed(now + 1), gpioRetryMaxUsec);
+}
+
+TEST(GpioBackoffTest, DoublesOnFailedReopen)
+{
+    GpioBackoff backoff;
+    EXPECT_EQ(backoff.failed(1000), gpioRetryMinUsec);
+    EXPECT_EQ(backoff.reopenFailed(), 2 * gpioRetryMinUsec);
+    EXPECT_EQ(backoff.reopenFailed(), 4 * gpioRetryMinUsec);
+}
+
+TEST(GpioBackoffTest, StartsOverOnceStable)
+{
+    GpioBackoff backoff;
+    backoff.failed(1000);
+    backoff.reopened(2000);
+    EXPECT_EQ(backoff.failed(3000), 2 * gpioRetryMinUsec);
+
+    backoff.reopened(4000);
+    EXPECT_EQ(backoff.failed(4000 + gpioStableUsec), gpioRetryMinUsec);
+}
+
+/**
+ * Creates an ID button on a simulated gpio whose reads all fail, and
+ * watches the read errors and re-opens of the line in the edge journal.
+ */
+class GpioRetryTest : public ::testing::Test
+{
+  protected:
+    static constexpr uint32_t number = 60;
+
+    void SetUp() override
+    {
+        ASSERT_TRUE(setGpioBackend("sim"));
+        sd_event* events = nullptr;
+        ASSERT_GE(sd_event_new(&events), 0);
+        event.reset(events);
+        bus.attach_event(event.get(), SD_EVENT_PRIORITY_NORMAL);
+    }
+
+    void TearDown() override
+    {
+        backend().failReads(number, 0);
+        button.reset();
+    }
+
+    static SimGpioBackend& backend()
+    {
+        return static_cast<SimGpioBackend&>(getGpioBackend());
+    }
+
+    /**
+     * @brief returns the timestamps of the journal entries of the button
+     * with the given action
+     */
+    static std::vector<uint64_t> journalTimes(EdgeAction action)
+    {
+        std::vector<uint64_t> times;
+        EdgeJournal::instance().forEach([&](const EdgeJournalEntry& entry) {
+            if ((entry.action == action) && (entry.button != nullptr) &&
+                (entry.button == ID_BUTTON))
+            {
+                times.push_back(entry.timestamp);
+            }
+        });
+        return times;
+    }
+
+    PrivateBus privateBus;
+    sdbusplus::bus_t bus = sdbusplus::bus::new_system();
+    EventPtr event;
+    std::unique_ptr<ButtonIface> button;
+};
+
+TEST_F(GpioRetryTest, RetryIntervalDoubles)
+{
+    buttonConfig config;
+    config.formFactorName = ID_BUTTON;
+    config.extraJsonInfo = {{"name", std::string{ID_BUTTON}}};
+    config.gpios.push_back(
+        {-1, number, "id", "both", GpioPolarity::activeLow});
+    button = ButtonFactory::createInstance(config.formFactorName, bus, event,
+                                           config);
+    ASSERT_TRUE(button);
+
+    auto errorsBefore = journalTimes(EdgeAction::readError).size();
+    auto reopensBefore = journalTimes(EdgeAction::recovered).size();
+    backend().failReads(number, -EIO);
+
+    // each re-open is followed by a read error right away
+    auto end = getMonotonicUsec() + 10 * 1000 * 1000;
+    while ((journalTimes(EdgeAction::readError).size() <
+            errorsBefore + retries + 1) &&
+           (getMonotonicUsec() < end))
+    {
+        sd_event_run(event.get(), 10000);
+    }
+
+    auto errors = journalTimes(EdgeAction::readError);
+    auto reopens = journalTimes(EdgeAction::recovered);
+    ASSERT_GE(errors.size(), errorsBefore + retries + 1);
+    ASSERT_GE(reopens.size(), reopensBefore + retries);
+
+    uint64_t expected = gpioRetryMinUsec;
+    for (size_t retry = 0; retry < retries; retry++)
+    {
+        auto interval = reopens[reopensBefore + retry] -
+                        errors[errorsBefore + retry];
+        EXPECT_GE(interval, expected) << "retry " << retry;
+        EXPECT_LT(interval, expected + timerSlackUsec) << "retry " << retry;
+        expected *= 2;
+    }
+}
+
+} // namespace test
+} // namespace button
+} // namespace phosphor
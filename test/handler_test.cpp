@@ -0,0 +1,602 @@
+#include "config.h"
+
+#include "button_handler.hpp"
+#include "fake_services.hpp"
+#include "gpio_backend.hpp"
+#include "private_bus.hpp"
+
+#include <sdbusplus/bus.hpp>
+
+#include <cerrno>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace phosphor
+{
+namespace button
+{
+namespace test
+{
+
+using namespace std::chrono_literals;
+
+constexpr auto powerIface = "xyz.openbmc_project.Chassis.Buttons.Power";
+constexpr auto resetIface = "xyz.openbmc_project.Chassis.Buttons.Reset";
+constexpr auto idIface = "xyz.openbmc_project.Chassis.Buttons.ID";
+constexpr auto debugHostSelectorIface =
+    "xyz.openbmc_project.Chassis.Buttons.Button";
+constexpr auto power2Path = "/xyz/openbmc_project/Chassis/Buttons/Power2";
+constexpr auto ledPath = "/xyz/openbmc_project/led/groups/" ID_LED_GROUP;
+
+constexpr auto hostOn = "xyz.openbmc_project.State.Host.Transition.On";
+constexpr auto hostOff = "xyz.openbmc_project.State.Host.Transition.Off";
+constexpr auto hostReboot = "xyz.openbmc_project.State.Host.Transition.Reboot";
+constexpr auto hostRunning =
+    "xyz.openbmc_project.State.Host.HostState.Running";
+constexpr auto chassisOff =
+    "xyz.openbmc_project.State.Chassis.Transition.Off";
+
+// longer than LONG_PRESS_TIME_MS, in microseconds as in the Released signal
+constexpr uint64_t longPressUsec = (LONG_PRESS_TIME_MS + 1000) * 1000ULL;
+
+// time given to the handler to act on a button signal
+constexpr auto actionTimeout = 5s;
+// time given to the handler to handle a signal which is to cause no call
+constexpr auto settleTime = 200ms;
+
+/**
+ * Runs the button handler against the fake services on a private bus. The
+ * button signals are sent from a connection of their own, as the buttons
+ * daemon would, and the handler is dispatched by an event loop run from the
+ * test until its calls show up at the fake services.
+ */
+class HandlerTest : public ::testing::Test
+{
+  protected:
+    void TearDown() override
+    {
+        handler.reset();
+    }
+
+    /**
+     * @brief starts the fake services and the handler, the buttons are
+     * listed in the mapper first as the handler looks them up at start
+     */
+    void start(size_t hosts, bool multiHost,
+               const std::string& policyPath = std::string())
+    {
+        fake = std::make_unique<FakeServices>(hosts, multiHost);
+        fake->addMapperObject(POWER_DBUS_OBJECT_NAME, buttonsService,
+                              {powerIface});
+        fake->addMapperObject(RESET_DBUS_OBJECT_NAME, buttonsService,
+                              {resetIface});
+        fake->addMapperObject(ID_DBUS_OBJECT_NAME, buttonsService, {idIface});
+        if (multiHost)
+        {
+            fake->addMapperObject(power2Path, buttonsService, {powerIface});
+            fake->addMapperObject(DBG_HS_DBUS_OBJECT_NAME, buttonsService,
+                                  {debugHostSelectorIface});
+        }
+
+        sd_event* events = nullptr;
+        ASSERT_GE(sd_event_new(&events), 0);
+        event.reset(events);
+        handlerBus.attach_event(event.get(), SD_EVENT_PRIORITY_NORMAL);
+        handler = std::make_unique<Handler>(handlerBus, policyPath);
+
+        // the lookups of the buttons are not part of any press
+        fake->resetCalls();
+    }
+
+    /**
+     * @brief sends a button signal, with the press duration of a Released
+     * signal of the power button
+     */
+    void emit(const std::string& path, const char* interface,
+              const char* member, std::optional<uint64_t> duration = {})
+    {
+        auto signal = buttonsBus.new_signal(path.c_str(), interface, member);
+        if (duration)
+        {
+            signal.append(*duration);
+        }
+        signal.signal_send();
+    }
+
+    void pressPower(const std::string& path = POWER_DBUS_OBJECT_NAME,
+                    uint64_t duration = 100000)
+    {
+        emit(path, powerIface, "Released", duration);
+    }
+
+    /**
+     * @brief dispatches the handler until the predicate holds
+     * @return false on timeout
+     */
+    bool runUntil(const std::function<bool()>& done,
+                  std::chrono::milliseconds timeout = actionTimeout)
+    {
+        auto end = std::chrono::steady_clock::now() + timeout;
+        while (!done())
+        {
+            if (std::chrono::steady_clock::now() >= end)
+            {
+                return false;
+            }
+            sd_event_run(event.get(), 10000);
+        }
+        return true;
+    }
+
+    void runFor(std::chrono::milliseconds duration)
+    {
+        runUntil([]() { return false; }, duration);
+    }
+
+    bool runUntilSets(size_t count)
+    {
+        return runUntil([this, count]() {
+            return fake->getSets().size() >= count;
+        });
+    }
+
+    /**
+     * @brief turns a host on behind the back of the handler, which caches
+     * the state from its PropertiesChanged signal
+     */
+    void setHostRunning(size_t host)
+    {
+        fake->setProperty(hostPath(host), "CurrentHostState",
+                          std::string{hostRunning});
+        runFor(settleTime);
+        fake->resetCalls();
+    }
+
+    static std::string hostPath(size_t host)
+    {
+        return HOST_STATE_OBJECT_NAME + std::to_string(host);
+    }
+
+    static std::string chassisPath(size_t host)
+    {
+        return CHASSIS_STATE_OBJECT_NAME + std::to_string(host);
+    }
+
+    PrivateBus privateBus;
+    sdbusplus::bus_t handlerBus = sdbusplus::bus::new_system();
+    sdbusplus::bus_t buttonsBus = sdbusplus::bus::new_system();
+    EventPtr event;
+    std::unique_ptr<FakeServices> fake;
+    std::unique_ptr<Handler> handler;
+};
+
+TEST_F(HandlerTest, PowerPressTurnsHostOn)
+{
+    start(1, false);
+
+    pressPower();
+    ASSERT_TRUE(runUntilSets(1));
+
+    auto sets = fake->getSets();
+    ASSERT_EQ(sets.size(), 1);
+    EXPECT_EQ(sets[0].path, hostPath(0));
+    EXPECT_EQ(sets[0].property, "RequestedHostTransition");
+    EXPECT_EQ(std::get<std::string>(sets[0].value), hostOn);
+
+    // the host selector lookup, then the host state service for the Get
+    // and the Set
+    EXPECT_EQ(fake->getCallCount("GetObject"), 3);
+    EXPECT_EQ(fake->getCallCount("Get CurrentHostState"), 1);
+    EXPECT_EQ(fake->getCallCount("Set RequestedHostTransition"), 1);
+    EXPECT_EQ(fake->getTotalCalls(), 5);
+}
+
+TEST_F(HandlerTest, PowerPressTurnsHostOffFromCachedState)
+{
+    start(1, false);
+
+    pressPower();
+    ASSERT_TRUE(runUntilSets(1));
+    // the Running state reaches the handler through PropertiesChanged
+    runFor(settleTime);
+    fake->resetCalls();
+
+    pressPower();
+    ASSERT_TRUE(runUntilSets(1));
+
+    auto sets = fake->getSets();
+    ASSERT_EQ(sets.size(), 1);
+    EXPECT_EQ(std::get<std::string>(sets[0].value), hostOff);
+    EXPECT_EQ(fake->getCallCount("Get CurrentHostState"), 0);
+    EXPECT_EQ(fake->getCallCount("GetObject"), 2);
+    EXPECT_EQ(fake->getTotalCalls(), 3);
+}
+
+TEST_F(HandlerTest, LongPowerPressTurnsChassisOff)
+{
+    start(1, false);
+    setHostRunning(0);
+
+    pressPower(POWER_DBUS_OBJECT_NAME, longPressUsec);
+    ASSERT_TRUE(runUntilSets(1));
+
+    auto sets = fake->getSets();
+    ASSERT_EQ(sets.size(), 1);
+    EXPECT_EQ(sets[0].path, chassisPath(0));
+    EXPECT_EQ(sets[0].property, "RequestedPowerTransition");
+    EXPECT_EQ(std::get<std::string>(sets[0].value), chassisOff);
+    EXPECT_EQ(fake->getCallCount("Set RequestedHostTransition"), 0);
+    EXPECT_EQ(fake->getTotalCalls(), 3);
+}
+
+TEST_F(HandlerTest, LongPowerPressWithHostOffDoesNothing)
+{
+    start(1, false);
+
+    pressPower(POWER_DBUS_OBJECT_NAME, longPressUsec);
+    runFor(settleTime);
+
+    EXPECT_TRUE(fake->getSets().empty());
+    EXPECT_EQ(fake->getCallCount("Get CurrentHostState"), 1);
+}
+
+TEST_F(HandlerTest, PressedLongActsOnceWithItsRelease)
+{
+    start(1, false);
+    setHostRunning(0);
+
+    emit(POWER_DBUS_OBJECT_NAME, powerIface, "PressedLong");
+    ASSERT_TRUE(runUntilSets(1));
+
+    // the release following the long press is not a press of its own
+    pressPower(POWER_DBUS_OBJECT_NAME, longPressUsec);
+    runFor(settleTime);
+
+    auto sets = fake->getSets();
+    ASSERT_EQ(sets.size(), 1);
+    EXPECT_EQ(std::get<std::string>(sets[0].value), chassisOff);
+}
+
+TEST_F(HandlerTest, ResetPressRebootsRunningHost)
+{
+    start(1, false);
+    setHostRunning(0);
+
+    emit(RESET_DBUS_OBJECT_NAME, resetIface, "Released");
+    ASSERT_TRUE(runUntilSets(1));
+
+    auto sets = fake->getSets();
+    ASSERT_EQ(sets.size(), 1);
+    EXPECT_EQ(sets[0].path, hostPath(0));
+    EXPECT_EQ(std::get<std::string>(sets[0].value), hostReboot);
+
+    // the state is known from the signal, it is not read
+    EXPECT_EQ(fake->getCallCount("Get CurrentHostState"), 0);
+    EXPECT_EQ(fake->getTotalCalls(), 3);
+}
+
+TEST_F(HandlerTest, ResetPressWithHostOffDoesNothing)
+{
+    start(1, false);
+
+    emit(RESET_DBUS_OBJECT_NAME, resetIface, "Released");
+    runFor(settleTime);
+
+    EXPECT_TRUE(fake->getSets().empty());
+    EXPECT_EQ(fake->getCallCount("Get CurrentHostState"), 1);
+}
+
+TEST_F(HandlerTest, IdPressTogglesLedGroup)
+{
+    start(1, false);
+
+    emit(ID_DBUS_OBJECT_NAME, idIface, "Released");
+    ASSERT_TRUE(runUntilSets(1));
+    EXPECT_EQ(std::get<bool>(fake->getProperty(ledPath, "Asserted")), true);
+    EXPECT_EQ(fake->getCallCount("GetObject"), 1);
+    EXPECT_EQ(fake->getCallCount("Get Asserted"), 1);
+    EXPECT_EQ(fake->getCallCount("Set Asserted"), 1);
+    EXPECT_EQ(fake->getTotalCalls(), 3);
+
+    emit(ID_DBUS_OBJECT_NAME, idIface, "Released");
+    ASSERT_TRUE(runUntilSets(2));
+    EXPECT_EQ(std::get<bool>(fake->getProperty(ledPath, "Asserted")), false);
+}
+
+TEST_F(HandlerTest, PressDroppedWhileTransitionInFlight)
+{
+    start(1, false);
+    fake->setCompleteTransitions(false);
+
+    pressPower();
+    ASSERT_TRUE(runUntilSets(1));
+    runFor(settleTime);
+    fake->resetCalls();
+
+    // the host has not reached the requested state yet
+    pressPower();
+    runFor(settleTime);
+
+    EXPECT_TRUE(fake->getSets().empty());
+    EXPECT_EQ(fake->getCallCount("Set RequestedHostTransition"), 0);
+    EXPECT_EQ(fake->getCallCount("Get CurrentHostState"), 0);
+}
+
+TEST_F(HandlerTest, ServiceLatencyDelaysAction)
+{
+    start(1, false);
+    constexpr auto latency = 100ms;
+    fake->setBehavior(hostService, {latency, 0});
+
+    auto pressUsec = getMonotonicUsec();
+    pressPower();
+    ASSERT_TRUE(runUntilSets(1));
+
+    // the Get of the host state and the Set both wait for the service
+    auto sets = fake->getSets();
+    ASSERT_EQ(sets.size(), 1);
+    EXPECT_GE(sets[0].usec - pressUsec,
+              2 * std::chrono::microseconds(latency).count());
+    EXPECT_EQ(fake->getTotalCalls(), 5);
+}
+
+TEST_F(HandlerTest, FailedStateReadTakesNoAction)
+{
+    start(1, false);
+    fake->setBehavior(hostService, {0us, EIO});
+
+    pressPower();
+    runFor(settleTime);
+    EXPECT_TRUE(fake->getSets().empty());
+    EXPECT_EQ(fake->getCallCount("Get CurrentHostState"), 1);
+    EXPECT_EQ(fake->getCallCount("Set RequestedHostTransition"), 0);
+
+    // nothing is left pending once the service answers again
+    fake->setBehavior(hostService, {});
+    pressPower();
+    ASSERT_TRUE(runUntilSets(1));
+    EXPECT_EQ(std::get<std::string>(fake->getSets()[0].value), hostOn);
+}
+
+TEST_F(HandlerTest, FailedTransitionDoesNotBlockNextPress)
+{
+    start(1, false);
+
+    pressPower();
+    ASSERT_TRUE(runUntilSets(1));
+    runFor(settleTime);
+    fake->resetCalls();
+
+    // the state is cached, only the Set reaches the failing service
+    fake->setBehavior(hostService, {0us, EIO});
+    pressPower();
+    runFor(settleTime);
+    EXPECT_TRUE(fake->getSets().empty());
+    EXPECT_EQ(fake->getCallCount("Set RequestedHostTransition"), 1);
+
+    fake->setBehavior(hostService, {});
+    pressPower();
+    ASSERT_TRUE(runUntilSets(1));
+    EXPECT_EQ(std::get<std::string>(fake->getSets()[0].value), hostOff);
+}
+
+TEST_F(HandlerTest, MapperFailureTakesNoAction)
+{
+    start(1, false);
+    fake->setBehavior(mapperService, {0us, EIO});
+
+    pressPower();
+    emit(ID_DBUS_OBJECT_NAME, idIface, "Released");
+    runFor(settleTime);
+
+    EXPECT_TRUE(fake->getSets().empty());
+    EXPECT_GE(fake->getCallCount("GetObject"), 2);
+    EXPECT_EQ(fake->getCallCount("Get CurrentHostState"), 0);
+    EXPECT_EQ(fake->getCallCount("Get Asserted"), 0);
+}
+
+TEST_F(HandlerTest, MultiHostPowerFollowsHostSelector)
+{
+    start(2, true);
+
+    pressPower();
+    ASSERT_TRUE(runUntilSets(1));
+
+    auto sets = fake->getSets();
+    ASSERT_EQ(sets.size(), 1);
+    EXPECT_EQ(sets[0].path, hostPath(1));
+    EXPECT_EQ(std::get<std::string>(sets[0].value), hostOn);
+    EXPECT_EQ(fake->getCallCount("GetObject"), 3);
+    EXPECT_EQ(fake->getCallCount("GetAll"), 1);
+    EXPECT_EQ(fake->getCallCount("Get CurrentHostState"), 1);
+    EXPECT_EQ(fake->getTotalCalls(), 6);
+}
+
+TEST_F(HandlerTest, MultiHostSelectorChangeIsCached)
+{
+    start(2, true);
+
+    pressPower();
+    ASSERT_TRUE(runUntilSets(1));
+    runFor(settleTime);
+
+    // moved by someone else, the handler follows its PropertiesChanged
+    fake->setProperty(HS_DBUS_OBJECT_NAME, "Position", uint64_t{2});
+    runFor(settleTime);
+    fake->resetCalls();
+
+    pressPower();
+    ASSERT_TRUE(runUntilSets(1));
+
+    auto sets = fake->getSets();
+    ASSERT_EQ(sets.size(), 1);
+    EXPECT_EQ(sets[0].path, hostPath(2));
+    EXPECT_EQ(fake->getCallCount("GetAll"), 0);
+    EXPECT_EQ(fake->getCallCount("GetObject"), 2);
+    EXPECT_EQ(fake->getCallCount("Get CurrentHostState"), 1);
+}
+
+TEST_F(HandlerTest, MultiHostPowerInstanceTargetsItsHost)
+{
+    start(2, true);
+
+    pressPower(power2Path);
+    ASSERT_TRUE(runUntilSets(1));
+
+    // the instance of host 2 does not read the host selector
+    auto sets = fake->getSets();
+    ASSERT_EQ(sets.size(), 1);
+    EXPECT_EQ(sets[0].path, hostPath(2));
+    EXPECT_EQ(fake->getCallCount("GetAll"), 0);
+    EXPECT_EQ(fake->getCallCount("GetObject"), 2);
+    EXPECT_EQ(fake->getTotalCalls(), 4);
+}
+
+TEST_F(HandlerTest, MultiHostResetFollowsHostSelector)
+{
+    start(2, true);
+    setHostRunning(1);
+
+    emit(RESET_DBUS_OBJECT_NAME, resetIface, "Released");
+    ASSERT_TRUE(runUntilSets(1));
+
+    auto sets = fake->getSets();
+    ASSERT_EQ(sets.size(), 1);
+    EXPECT_EQ(sets[0].path, hostPath(1));
+    EXPECT_EQ(std::get<std::string>(sets[0].value), hostReboot);
+}
+
+TEST_F(HandlerTest, DebugHostSelectorPressMovesPosition)
+{
+    start(2, true);
+
+    emit(DBG_HS_DBUS_OBJECT_NAME, debugHostSelectorIface, "Released");
+    ASSERT_TRUE(runUntilSets(1));
+    EXPECT_EQ(std::get<uint64_t>(
+                  fake->getProperty(HS_DBUS_OBJECT_NAME, "Position")),
+              2);
+    EXPECT_EQ(fake->getCallCount("GetObject"), 1);
+    EXPECT_EQ(fake->getCallCount("GetAll"), 1);
+    EXPECT_EQ(fake->getCallCount("Set Position"), 1);
+    runFor(settleTime);
+
+    // wraps around to the BMC from the local position, without a read
+    emit(DBG_HS_DBUS_OBJECT_NAME, debugHostSelectorIface, "Released");
+    ASSERT_TRUE(runUntilSets(2));
+    EXPECT_EQ(std::get<uint64_t>(
+                  fake->getProperty(HS_DBUS_OBJECT_NAME, "Position")),
+              0);
+    EXPECT_EQ(fake->getCallCount("GetAll"), 1);
+    EXPECT_EQ(fake->getTotalCalls(), 4);
+}
+
+TEST_F(HandlerTest, DebugHostSelectorLongPressKeepsPosition)
+{
+    start(2, true);
+
+    emit(DBG_HS_DBUS_OBJECT_NAME, debugHostSelectorIface, "PressedLong");
+    emit(DBG_HS_DBUS_OBJECT_NAME, debugHostSelectorIface, "Released");
+    runFor(settleTime);
+
+    EXPECT_TRUE(fake->getSets().empty());
+    EXPECT_EQ(fake->getTotalCalls(), 0);
+}
+
+/**
+ * Runs the handler with a policy file, written to the directory of the
+ * private bus.
+ */
+class HandlerPolicyTest : public HandlerTest
+{
+  protected:
+    std::string writePolicy(const std::string& policy)
+    {
+        auto path = privateBus.getDirectory() + "/policy.json";
+        std::ofstream{path} << policy;
+        return path;
+    }
+};
+
+TEST_F(HandlerPolicyTest, AllHostsOnFromBmcPosition)
+{
+    auto policy = writePolicy(R"({
+        "policy": [{"button": "power", "gesture": "press",
+                    "selector": "bmc", "host_state": "any",
+                    "action": "all_hosts_on"}]
+    })");
+    start(2, true, policy);
+    fake->setProperty(HS_DBUS_OBJECT_NAME, "Position", uint64_t{0});
+    runFor(settleTime);
+    fake->resetCalls();
+
+    pressPower();
+    ASSERT_TRUE(runUntilSets(2));
+    runFor(settleTime);
+
+    auto sets = fake->getSets();
+    ASSERT_EQ(sets.size(), 2);
+    std::set<std::string> paths{sets[0].path, sets[1].path};
+    EXPECT_EQ(paths, (std::set<std::string>{hostPath(1), hostPath(2)}));
+    for (const auto& set : sets)
+    {
+        EXPECT_EQ(std::get<std::string>(set.value), hostOn);
+    }
+
+    // the action does not depend on the host states, none is read
+    EXPECT_EQ(fake->getCallCount("Get CurrentHostState"), 0);
+    EXPECT_EQ(fake->getCallCount("GetAll"), 1);
+    EXPECT_EQ(fake->getCallCount("GetObject"), 3);
+    EXPECT_EQ(fake->getCallCount("Set RequestedHostTransition"), 2);
+}
+
+TEST_F(HandlerPolicyTest, AllHostsFanOutIsStaggered)
+{
+    auto policy = writePolicy(R"({
+        "fan_out": {"max_concurrent": 1, "stagger_ms": 100},
+        "policy": [{"button": "power", "gesture": "press",
+                    "selector": "bmc", "host_state": "any",
+                    "action": "all_hosts_on"}]
+    })");
+    start(2, true, policy);
+    fake->setProperty(HS_DBUS_OBJECT_NAME, "Position", uint64_t{0});
+    runFor(settleTime);
+    fake->resetCalls();
+
+    pressPower();
+    ASSERT_TRUE(runUntilSets(2));
+
+    auto sets = fake->getSets();
+    ASSERT_EQ(sets.size(), 2);
+    EXPECT_EQ(sets[0].path, hostPath(1));
+    EXPECT_EQ(sets[1].path, hostPath(2));
+    EXPECT_GE(sets[1].usec - sets[0].usec, 100000);
+}
+
+TEST_F(HandlerPolicyTest, PolicyRuleOverridesDefault)
+{
+    auto policy = writePolicy(R"({
+        "policy": [{"button": "reset", "gesture": "any",
+                    "selector": "any", "host_state": "any",
+                    "action": "none"}]
+    })");
+    start(1, false, policy);
+    setHostRunning(0);
+
+    emit(RESET_DBUS_OBJECT_NAME, resetIface, "Released");
+    runFor(settleTime);
+
+    // no action whatever the host state, the state is not read
+    EXPECT_TRUE(fake->getSets().empty());
+    EXPECT_EQ(fake->getCallCount("Get CurrentHostState"), 0);
+}
+
+} // namespace test
+} // namespace button
+} // namespace phosphor
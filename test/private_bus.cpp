@@ -0,0 +1,127 @@
+#include "private_bus.hpp"
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace phosphor
+{
+namespace button
+{
+namespace test
+{
+
+namespace fs = std::filesystem;
+
+// lets any client own any name and talk to anyone, it is a bus of its own
+constexpr auto busConfig = R"(<!DOCTYPE busconfig PUBLIC
+ "-//freedesktop//DTD D-BUS Bus Configuration 1.0//EN"
+ "http://www.freedesktop.org/standards/dbus/1.0/busconfig.dtd">
+<busconfig>
+  <type>session</type>
+  <listen>unix:path=@SOCKET@</listen>
+  <auth>EXTERNAL</auth>
+  <policy context="default">
+    <allow user="*"/>
+    <allow own="*"/>
+    <allow send_type="method_call"/>
+    <allow send_type="signal"/>
+    <allow send_type="method_return"/>
+    <allow send_type="error"/>
+    <allow receive_type="method_call"/>
+    <allow receive_type="signal"/>
+    <allow receive_type="method_return"/>
+    <allow receive_type="error"/>
+  </policy>
+</busconfig>
+)";
+
+PrivateBus::PrivateBus()
+{
+    char dirTemplate[] = "/tmp/phosphor-buttons-bus-XXXXXX";
+    if (::mkdtemp(dirTemplate) == nullptr)
+    {
+        throw std::runtime_error("Failed to create the bus directory");
+    }
+    directory = dirTemplate;
+
+    std::string config{busConfig};
+    std::string socket = directory + "/bus";
+    config.replace(config.find("@SOCKET@"), std::string("@SOCKET@").size(),
+                   socket);
+    auto configFile = directory + "/bus.conf";
+    std::ofstream{configFile} << config;
+
+    int pipeFds[2];
+    if (::pipe(pipeFds) < 0)
+    {
+        fs::remove_all(directory);
+        throw std::runtime_error("Failed to create the bus address pipe");
+    }
+
+    pid = ::fork();
+    if (pid == 0)
+    {
+        ::close(pipeFds[0]);
+        auto configArg = "--config-file=" + configFile;
+        auto addressArg = "--print-address=" + std::to_string(pipeFds[1]);
+        ::execlp("dbus-daemon", "dbus-daemon", configArg.c_str(), "--nofork",
+                 addressArg.c_str(), nullptr);
+        ::_exit(127);
+    }
+    ::close(pipeFds[1]);
+    if (pid < 0)
+    {
+        ::close(pipeFds[0]);
+        fs::remove_all(directory);
+        throw std::runtime_error("Failed to start dbus-daemon");
+    }
+
+    // the daemon prints its address once it listens
+    char buf[512];
+    ssize_t n = 0;
+    while ((n = ::read(pipeFds[0], buf, sizeof(buf))) > 0)
+    {
+        address.append(buf, n);
+        if (address.find('\n') != std::string::npos)
+        {
+            break;
+        }
+    }
+    ::close(pipeFds[0]);
+
+    auto newline = address.find('\n');
+    if (newline == std::string::npos)
+    {
+        ::kill(pid, SIGTERM);
+        ::waitpid(pid, nullptr, 0);
+        fs::remove_all(directory);
+        throw std::runtime_error("dbus-daemon did not start");
+    }
+    address.erase(newline);
+
+    ::setenv("DBUS_SYSTEM_BUS_ADDRESS", address.c_str(), 1);
+    ::setenv("DBUS_STARTER_ADDRESS", address.c_str(), 1);
+    ::setenv("DBUS_STARTER_BUS_TYPE", "system", 1);
+}
+
+PrivateBus::~PrivateBus()
+{
+    if (pid > 0)
+    {
+        ::kill(pid, SIGTERM);
+        ::waitpid(pid, nullptr, 0);
+    }
+    std::error_code ec;
+    fs::remove_all(directory, ec);
+}
+
+} // namespace test
+} // namespace button
+} // namespace phosphor
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <string>
+
+namespace phosphor
+{
+namespace button
+{
+namespace test
+{
+
+/**
+ * @class PrivateBus
+ *
+ * A dbus-daemon of its own, so the tests and the benchmarks can run the
+ * daemons and the fake services without the system bus. The bus socket
+ * lives in a temporary directory, and DBUS_SYSTEM_BUS_ADDRESS along with
+ * DBUS_STARTER_BUS_TYPE point the calling process, and the processes it
+ * starts afterwards, at it. Throws std::runtime_error if dbus-daemon cannot
+ * be started.
+ */
+class PrivateBus
+{
+  public:
+    PrivateBus(const PrivateBus&) = delete;
+    PrivateBus& operator=(const PrivateBus&) = delete;
+    PrivateBus(PrivateBus&&) = delete;
+    PrivateBus& operator=(PrivateBus&&) = delete;
+
+    PrivateBus();
+    ~PrivateBus();
+
+    const std::string& getAddress() const
+    {
+        return address;
+    }
+
+    // the temporary directory, removed along with the bus
+    const std::string& getDirectory() const
+    {
+        return directory;
+    }
+
+  private:
+    std::string directory;
+    std::string address;
+    pid_t pid = -1;
+};
+
+} // namespace test
+} // namespace button
+} // namespace phosphor
@@ -0,0 +1,136 @@
+#include "realtime.hpp"
+
+#include <sched.h>
+#include <time.h>
+
+#include <cerrno>
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+using namespace std::chrono_literals;
+
+constexpr auto budgetInterval =
+    std::chrono::microseconds(rtBudgetIntervalUsec);
+// long enough for the budget timer to check the interval the spinning
+// ended in, then one more
+constexpr auto checkTime = 2 * budgetInterval + 50ms;
+
+uint64_t threadCpuUsec()
+{
+    timespec ts{};
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * A handler of the event loop spinning on the CPU: it burns spinUsec of
+ * CPU time each time it runs, every gapUsec until untilUsec.
+ */
+struct Spinner
+{
+    uint64_t spinUsec;
+    uint64_t gapUsec;
+    uint64_t untilUsec;
+    EventSourcePtr timer;
+
+    static int handler(sd_event_source* /* es */, uint64_t usec,
+                       void* userdata)
+    {
+        auto* spinner = static_cast<Spinner*>(userdata);
+        auto end = threadCpuUsec() + spinner->spinUsec;
+        while (threadCpuUsec() < end)
+        {}
+
+        if (usec + spinner->gapUsec < spinner->untilUsec)
+        {
+            sd_event_source_set_time(spinner->timer.get(),
+                                     usec + spinner->gapUsec);
+            sd_event_source_set_enabled(spinner->timer.get(),
+                                        SD_EVENT_ONESHOT);
+        }
+        return 0;
+    }
+
+    void start(EventPtr& event)
+    {
+        sd_event_source* source = nullptr;
+        uint64_t now = 0;
+        sd_event_now(event.get(), CLOCK_MONOTONIC, &now);
+        ASSERT_GE(sd_event_add_time(event.get(), &source, CLOCK_MONOTONIC, now,
+                                    0, handler, this),
+                  0);
+        timer.reset(source);
+    }
+};
+
+void runFor(EventPtr& event, std::chrono::microseconds duration)
+{
+    auto end = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < end)
+    {
+        sd_event_run(event.get(), 10000);
+    }
+}
+
+int getScheduler()
+{
+    return ::sched_getscheduler(0);
+}
+
+} // namespace
+
+TEST(RealtimeModeTest, DemotedOverBudgetAndPromotedBack)
+{
+    sd_event* events = nullptr;
+    ASSERT_GE(sd_event_new(&events), 0);
+    EventPtr event{events};
+
+    auto& realtime = RealtimeMode::instance();
+    EXPECT_FALSE(realtime.promoted());
+
+    // the real-time scheduler needs CAP_SYS_NICE, and locking the memory
+    // CAP_IPC_LOCK or a large enough RLIMIT_MEMLOCK
+    int ret = realtime.enable(event, 10);
+    if ((ret == -EPERM) || (ret == -ENOMEM) || (ret == -EAGAIN))
+    {
+        GTEST_SKIP() << "No permission for the real-time mode: " << ret;
+    }
+    ASSERT_EQ(ret, 0);
+    EXPECT_TRUE(realtime.promoted());
+    EXPECT_EQ(getScheduler(), SCHED_FIFO);
+    EXPECT_EQ(realtime.getDemotions(), 0);
+
+    // a handler spinning without blocking past the burst limit is demoted
+    // by SIGXCPU, right away
+    Spinner burst{2 * rtBurstLimitUsec, 0, 0, {}};
+    burst.start(event);
+    runFor(event, 10ms);
+    EXPECT_EQ(getScheduler(), SCHED_OTHER);
+
+    // the budget timer takes note of it, and promotes the loop back after
+    // an interval within the budget
+    runFor(event, budgetInterval + 50ms);
+    EXPECT_EQ(realtime.getDemotions(), 1);
+    runFor(event, checkTime);
+    EXPECT_TRUE(realtime.promoted());
+    EXPECT_EQ(getScheduler(), SCHED_FIFO);
+
+    // short handlers, each under the burst limit, which add up to more
+    // than the budget of an interval
+    uint64_t now = 0;
+    sd_event_now(event.get(), CLOCK_MONOTONIC, &now);
+    Spinner busy{rtBurstLimitUsec / 4, rtBurstLimitUsec / 2,
+                 now + 2 * rtBudgetIntervalUsec, {}};
+    busy.start(event);
+    runFor(event, checkTime);
+    EXPECT_EQ(realtime.getDemotions(), 2);
+
+    // promoted back once the handlers stopped
+    runFor(event, checkTime);
+    EXPECT_TRUE(realtime.promoted());
+    EXPECT_EQ(getScheduler(), SCHED_FIFO);
+}